@@ -0,0 +1,188 @@
+/**
+ * 共享监听fd的唤醒测试程序
+ *
+ * 多个线程各自运行一个事件循环，都监视同一个监听socket，主线程逐个发起连接，
+ * 统计每个连接唤醒了多少个线程：
+ * 1. 不带EV_EXCLUSIVE时，一个连接会唤醒所有阻塞的线程(惊群)，只有一个能accept成功，
+ *    其余线程在内核中发现fd已不再就绪后继续睡眠，回调不会被调用，只能从线程的主动上下文切换次数看出
+ * 2. 带EV_EXCLUSIVE时(epoll后端)，每个连接只唤醒一个线程
+ *
+ * 每10个连接中有一个是在一半的线程停止监视器期间发起的，检查停止了监视器的循环
+ * 不会吞掉唯一的一次唤醒：每个连接都应在短时间内被accept，否则计入stalled。
+ *
+ * 编译命令: g++ -std=c++20 -O2 -pthread -o accept_bench accept_bench.cpp ev.cpp
+ * 运行方式: ./accept_bench [线程数] [连接数] [0:普通 1:EV_EXCLUSIVE 2:EV_EXCLUSIVE|EV_ET]
+ */
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "ev.h"
+
+static int listen_fd;
+static std::atomic<long> wakeups;  /* 回调次数 */
+static std::atomic<long> accepted; /* accept成功次数 */
+static std::atomic<long> switches; /* 工作线程的主动上下文切换次数，即被唤醒的次数 */
+
+struct worker
+{
+    struct ev_loop *loop;
+    ev_io io;
+    ev_async cmd; /* 主线程通过它让循环停止监视器、重新启动或退出 */
+    std::atomic<int> op;
+    std::atomic<int> done;
+    long nvcsw; /* 开始测量时的主动上下文切换次数 */
+};
+
+/* 当前线程的主动上下文切换次数 */
+static long thread_nvcsw()
+{
+    rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return ru.ru_nvcsw;
+}
+
+static void accept_cb(struct ev_loop *loop, ev_io *w, int revents) noexcept
+{
+    int fd;
+
+    ++wakeups;
+
+    /* 边沿触发时必须一直accept到EAGAIN */
+    while ((fd = accept(w->fd, 0, 0)) >= 0)
+    {
+        ++accepted;
+        close(fd);
+    }
+}
+
+static void cmd_cb(struct ev_loop *loop, ev_async *w, int revents) noexcept
+{
+    worker *k = (worker *)w->data;
+
+    switch (k->op.load())
+    {
+    case 0:
+        k->nvcsw = thread_nvcsw();
+        break;
+    case 1:
+        ev_io_stop(loop, &k->io);
+        break;
+    case 2:
+        ev_io_start(loop, &k->io);
+        break;
+    case 3:
+        switches += thread_nvcsw() - k->nvcsw;
+        ev_io_stop(loop, &k->io);
+        ev_async_stop(loop, &k->cmd);
+        break;
+    }
+
+    k->done = 1;
+}
+
+/* 向所有线程发出命令并等待执行完毕 */
+static void command(std::vector<worker> &workers, int from, int to, int op)
+{
+    for (int i = from; i < to; ++i)
+    {
+        workers[i].done = 0;
+        workers[i].op = op;
+        ev_async_send(workers[i].loop, &workers[i].cmd);
+    }
+
+    for (int i = from; i < to; ++i)
+        while (!workers[i].done)
+            usleep(100);
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 8;
+    int conns = argc > 2 ? atoi(argv[2]) : 200;
+    int mode = argc > 3 ? atoi(argv[3]) : 1;
+    int events = EV_READ | (mode >= 1 ? EV_EXCLUSIVE : 0) | (mode >= 2 ? EV_ET : 0);
+    int stalled = 0;  /* 2毫秒内没有被accept的连接数 */
+    int stopped = 0;  /* 停止/启动命令引起的线程唤醒，从统计中扣除 */
+    std::vector<worker> workers(threads);
+    std::vector<std::thread> pool;
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, 1024))
+    {
+        perror("listen");
+        return 1;
+    }
+    getsockname(listen_fd, (sockaddr *)&addr, &len);
+
+    for (auto &k : workers)
+    {
+        k.loop = ev_loop_new(EVBACKEND_EPOLL);
+        ev_io_init(&k.io, accept_cb, listen_fd, events);
+        ev_io_start(k.loop, &k.io);
+        ev_async_init(&k.cmd, cmd_cb);
+        k.cmd.data = &k;
+        ev_async_start(k.loop, &k.cmd);
+    }
+
+    for (auto &k : workers)
+        pool.emplace_back([&k] { ev_run(k.loop, 0); });
+
+    /* 等所有循环都阻塞在epoll_wait中 */
+    usleep(100000);
+    command(workers, 0, threads, 0);
+
+    for (int i = 0; i < conns; ++i)
+    {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        int stop = !(i % 10);
+
+        /* 独占注册必须随监视器停止立即删除，否则内核可能只唤醒已停止的循环 */
+        if (stop)
+            command(workers, 0, threads / 2, 1);
+
+        connect(fd, (sockaddr *)&addr, sizeof(addr));
+        close(fd);
+        usleep(2000);
+
+        if (accepted <= i)
+            ++stalled;
+
+        if (stop)
+        {
+            command(workers, 0, threads / 2, 2);
+            stopped += threads / 2;
+        }
+    }
+
+    usleep(100000);
+
+    command(workers, 0, threads, 3);
+    for (auto &t : pool)
+        t.join();
+
+    printf("threads %d, mode %d\n", threads, mode);
+    printf("connections %d, accepted %ld\n", conns, accepted.load());
+    printf("callbacks %ld (%.2f per connection)\n", wakeups.load(), (double)wakeups / conns);
+    printf("connections not accepted within 2ms %d\n", stalled);
+    printf("thread wakeups %.2f per connection\n", (double)(switches - 2 * stopped) / conns);
+
+    for (auto &k : workers)
+        ev_loop_destroy(k.loop);
+
+    return accepted == conns && !stalled ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/**
+ * ev_cron测试程序
+ *
+ * 检查ev_cron_set_spec的解析和下次触发时刻的计算：
+ * 1. 合法的规则：*、列表、a-b范围、/步长，星期几的7表示星期日
+ * 2. 非法的规则：越界的值、a>b的范围、步长为0、多余的字符，失败时监视器保持不变
+ * 3. 固定时刻上的下次触发：负的tzoff、跨过周六到周日的一周边界
+ * 4. 随机的掩码、时区和当前时间，与逐分钟用gmtime查找的结果比较
+ *
+ * 编译命令: g++ -std=c++20 -O2 -o cron_test cron_test.cpp ev.cpp
+ * 运行方式: ./cron_test [随机规则数量]
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include "ev.h"
+
+static int failures;
+
+#define CHECK(cond, ...)                                      \
+    do                                                        \
+    {                                                         \
+        if (!(cond))                                          \
+        {                                                     \
+            printf("%s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            printf(__VA_ARGS__);                              \
+            putchar('\n');                                    \
+            ++failures;                                       \
+        }                                                     \
+    } while (0)
+
+static void cron_cb(struct ev_loop *loop, ev_cron *w, int revents) noexcept
+{
+}
+
+/* UTC日历时间对应的时间戳 */
+static ev_tstamp utc(int year, int mon, int mday, int hour, int min, int sec)
+{
+    struct tm tm = {};
+
+    tm.tm_year = year - 1900;
+    tm.tm_mon = mon - 1;
+    tm.tm_mday = mday;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+
+    return (ev_tstamp)timegm(&tm);
+}
+
+/* now之后第一个满足规则的整分钟，逐分钟用gmtime检查，最多找8天 */
+static ev_tstamp brute_next(const ev_cron *w, ev_tstamp now)
+{
+    long long minute = (long long)floor((now + w->tzoff) / 60.) + 1;
+
+    for (int i = 0; i < 8 * 1440; ++i, ++minute)
+    {
+        time_t t = (time_t)(minute * 60);
+        struct tm tm;
+
+        gmtime_r(&t, &tm);
+
+        if ((w->minutes >> tm.tm_min & 1) && (w->hours >> tm.tm_hour & 1) && (w->wdays >> tm.tm_wday & 1))
+            return (ev_tstamp)(minute * 60 - w->tzoff);
+    }
+
+    return -1.;
+}
+
+/* 按当前的掩码计算now之后的触发时刻，reschedule_cb由ev_cron_start设置 */
+static ev_tstamp cron_next(ev_cron *w, ev_tstamp now)
+{
+    return w->reschedule_cb((ev_periodic *)w, now);
+}
+
+static void test_parse()
+{
+    static const struct
+    {
+        const char *spec;
+        uint64_t minutes;
+        uint32_t hours;
+        uint32_t wdays;
+    } good[] = {
+        {"* * *", 0x0fffffffffffffffULL, 0xffffff, 0x7f},
+        {"0,30 9-17 1-5", 1ULL << 0 | 1ULL << 30, 0x3fe00, 0x3e},
+        {"*/15 */6 *", 1ULL << 0 | 1ULL << 15 | 1ULL << 30 | 1ULL << 45, 1 << 0 | 1 << 6 | 1 << 12 | 1 << 18, 0x7f},
+        {"5/20 10-20/5 *", 1ULL << 5 | 1ULL << 25 | 1ULL << 45, 1 << 10 | 1 << 15 | 1 << 20, 0x7f},
+        {"59 23 7", 1ULL << 59, 1 << 23, 0x01},
+        {"0 0 0,7", 1, 1, 0x01},
+        {"0 0 5-7", 1, 1, 0x61},
+        {" \t1,2 3\t4 ", 0x6, 1 << 3, 1 << 4},
+    };
+    static const char *bad[] = {
+        "", "* *", "* * * *", "60 * *", "* 24 *", "* * 8", "5-3 * *", "* 9-1 *",
+        "*/0 * *", "0/0 * *", "* * 1-", "a * *", "1,,2 * *", "1, * *", "* * 1x",
+        "1 2 3 x", "0x10 * *", "-1 * *", "1000 * *",
+    };
+
+    for (auto &g : good)
+    {
+        ev_cron w;
+
+        ev_init(&w, cron_cb);
+        CHECK(!ev_cron_set_spec(&w, g.spec, 3600), "'%s' rejected", g.spec);
+        CHECK(w.minutes == g.minutes, "'%s' minutes %llx", g.spec, (unsigned long long)w.minutes);
+        CHECK(w.hours == g.hours, "'%s' hours %x", g.spec, w.hours);
+        CHECK(w.wdays == g.wdays, "'%s' wdays %x", g.spec, w.wdays);
+        CHECK(w.tzoff == 3600, "'%s' tzoff %d", g.spec, w.tzoff);
+    }
+
+    for (auto spec : bad)
+    {
+        ev_cron w;
+
+        ev_cron_init(&w, cron_cb, 1, 2, 4, 7);
+        CHECK(ev_cron_set_spec(&w, spec, 0) == -1, "'%s' accepted", spec);
+        CHECK(w.minutes == 1 && w.hours == 2 && w.wdays == 4 && w.tzoff == 7, "'%s' changed the watcher", spec);
+    }
+}
+
+static void test_fixed(struct ev_loop *loop)
+{
+    ev_cron w;
+
+    /* 2026-10-17是星期六 */
+    ev_init(&w, cron_cb);
+    ev_cron_set_spec(&w, "0 9 *", -5 * 3600);
+    ev_cron_start(loop, &w);
+    ev_cron_stop(loop, &w);
+
+    /* UTC-5的9点是UTC的14点，本地时间还是前一天时也一样 */
+    CHECK(cron_next(&w, utc(2026, 10, 17, 12, 0, 0)) == utc(2026, 10, 17, 14, 0, 0), "tzoff -5h");
+    CHECK(cron_next(&w, utc(2026, 10, 17, 2, 0, 0)) == utc(2026, 10, 17, 14, 0, 0), "tzoff -5h, previous local day");
+    CHECK(cron_next(&w, utc(2026, 10, 17, 14, 0, 0)) == utc(2026, 10, 18, 14, 0, 0), "tzoff -5h, exactly at the minute");
+
+    /* 负偏移且不是整小时 */
+    ev_cron_set_spec(&w, "30 23 6", -(3 * 3600 + 1800));
+    CHECK(cron_next(&w, utc(2026, 10, 17, 0, 0, 0)) == utc(2026, 10, 18, 3, 0, 0), "tzoff -3:30");
+
+    /* 周六23:59:30到周日0点，跨过星期几编号的回绕 */
+    ev_cron_set_spec(&w, "0 0 0", 0);
+    CHECK(cron_next(&w, utc(2026, 10, 17, 23, 59, 30)) == utc(2026, 10, 18, 0, 0, 0), "saturday to sunday");
+
+    ev_cron_set_spec(&w, "0 0 7", 0);
+    CHECK(cron_next(&w, utc(2026, 10, 17, 23, 59, 30)) == utc(2026, 10, 18, 0, 0, 0), "weekday 7 is sunday");
+
+    /* 只允许周六0点，刚过了这一分钟，要等整整一周 */
+    ev_cron_set_spec(&w, "0 0 6", 0);
+    CHECK(cron_next(&w, utc(2026, 10, 17, 0, 0, 30)) == utc(2026, 10, 24, 0, 0, 0), "full week");
+
+    /* 今天剩下的分钟都不满足，第8天才匹配的最早分钟 */
+    ev_cron_set_spec(&w, "0 0 6", 0);
+    CHECK(cron_next(&w, utc(2026, 10, 17, 0, 0, 0)) == utc(2026, 10, 24, 0, 0, 0), "exact minute rolls over a week");
+
+    /* 正偏移让本地时间跨到星期日 */
+    ev_cron_set_spec(&w, "0 0 0", 9 * 3600);
+    CHECK(cron_next(&w, utc(2026, 10, 17, 14, 30, 0)) == utc(2026, 10, 17, 15, 0, 0), "tzoff +9h into sunday");
+
+    /* 1970年之前的时间 */
+    ev_cron_set_spec(&w, "0 0 3", -3600);
+    CHECK(cron_next(&w, -86400. * 3) == brute_next(&w, -86400. * 3), "before the epoch");
+}
+
+static void test_random(struct ev_loop *loop, int count)
+{
+    int mismatches = 0;
+
+    srand(23);
+
+    for (int i = 0; i < count; ++i)
+    {
+        ev_cron w;
+        ev_tstamp now, got, want;
+
+        ev_init(&w, cron_cb);
+
+        /* 一半是稠密的掩码，一半是稀疏的 */
+        w.minutes = ((uint64_t)rand() << 31 | (uint64_t)rand()) & 0x0fffffffffffffffULL;
+        if (i & 1)
+            w.minutes &= (uint64_t)rand() * (uint64_t)rand();
+        if (!w.minutes)
+            w.minutes = 1ULL << (rand() % 60);
+
+        w.hours = rand() & 0xffffff;
+        if (i & 2)
+            w.hours &= rand();
+        if (!w.hours)
+            w.hours = 1u << (rand() % 24);
+
+        w.wdays = 1u << (rand() % 7);
+        if (i & 4)
+            w.wdays |= rand() & 0x7f;
+
+        w.tzoff = (rand() % 57 - 28) * 1800;
+
+        ev_cron_start(loop, &w);
+
+        /* 启动时按循环的当前时间计算 */
+        got = ev_periodic_at(&w);
+        want = brute_next(&w, ev_now(loop));
+        if (got != want && mismatches++ < 10)
+            printf("start: mismatch %.0f, expected %.0f\n", got, want);
+
+        ev_cron_stop(loop, &w);
+
+        /* 任意时刻，包括整分钟和负的时间戳 */
+        now = (ev_tstamp)rand() - 2e8;
+        if (i & 8)
+            now += (rand() % 1000) * 1e-3;
+
+        got = cron_next(&w, now);
+        want = brute_next(&w, now);
+        if (got != want && mismatches++ < 10)
+            printf("now %.3f tzoff %d: mismatch %.0f, expected %.0f\n", now, w.tzoff, got, want);
+    }
+
+    CHECK(!mismatches, "%d of %d random schedules differ from gmtime", mismatches, count * 2);
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 20000;
+    struct ev_loop *loop = ev_loop_new(0);
+
+    test_parse();
+    test_fixed(loop);
+    test_random(loop, count);
+
+    ev_loop_destroy(loop);
+
+    printf("%s: %d failures\n", failures ? "FAILED" : "ok", failures);
+
+    return failures ? 1 : 0;
+}
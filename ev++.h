@@ -193,6 +193,11 @@ namespace ev
             return ev_now(EV_AX);
         }
 
+        ev_tstamp_ns mono_now_ns() const throw()
+        {
+            return ev_mono_now_ns(EV_AX);
+        }
+
         void ref() throw()
         {
             ev_ref(EV_AX);
@@ -223,6 +228,23 @@ namespace ev
         {
             ev_set_timeout_collect_interval(EV_AX_ interval);
         }
+
+        void set_busy_poll(tstamp budget) throw()
+        {
+            ev_set_busy_poll(EV_AX_ budget);
+        }
+
+        void set_timer_slack(tstamp slack) throw()
+        {
+            ev_set_timer_slack(EV_AX_ slack);
+        }
+
+#if EV_HRTIMER_ENABLE
+        void set_hires_margin(tstamp margin) throw()
+        {
+            ev_set_hires_margin(EV_AX_ margin);
+        }
+#endif
 #endif
 
         // function callback
@@ -300,6 +322,13 @@ namespace ev
             ev_feed_signal_event(EV_AX_ signum);
         }
 
+#if EV_ASYNC_ENABLE
+        void set_feed_mt_size(int size) throw()
+        {
+            ev_set_feed_mt_size(EV_AX_ size);
+        }
+#endif
+
 #if EV_MULTIPLICITY
         struct ev_loop *EV_AX;
 #endif
@@ -464,6 +493,13 @@ namespace ev
         {
             ev_feed_event(loop, static_cast<ev_watcher *>(this), revents);
         }
+
+#if EV_ASYNC_ENABLE
+        bool feed_event_mt(int revents) throw()
+        {
+            return ev_feed_event_mt(loop, static_cast<ev_watcher *>(this), revents);
+        }
+#endif
     };
 
     inline tstamp now(struct ev_loop *loop) throw()
@@ -616,6 +652,26 @@ namespace ev
     }
     EV_END_WATCHER(timer, timer)
 
+#if EV_HRTIMER_ENABLE
+    EV_BEGIN_WATCHER(hrtimer, hrtimer)
+    void set(ev_tstamp after, ev_tstamp repeat = 0.) throw()
+    {
+        int active = is_active();
+        if (active)
+            stop();
+        ev_hrtimer_set(static_cast<ev_hrtimer *>(this), after, repeat);
+        if (active)
+            start();
+    }
+
+    void start(ev_tstamp after, ev_tstamp repeat = 0.) throw()
+    {
+        set(after, repeat);
+        start();
+    }
+    EV_END_WATCHER(hrtimer, hrtimer)
+#endif
+
 #if EV_PERIODIC_ENABLE
     EV_BEGIN_WATCHER(periodic, periodic)
     void set(ev_tstamp at, ev_tstamp interval = 0.) throw()
@@ -756,6 +812,61 @@ namespace ev
     EV_END_WATCHER(fork, fork)
 #endif
 
+#if EV_CRON_ENABLE
+    EV_BEGIN_WATCHER(cron, cron)
+    void set(uint64_t minutes, uint32_t hours, uint32_t wdays, int tzoff = 0) throw()
+    {
+        int active = is_active();
+        if (active)
+            stop();
+        ev_cron_set(static_cast<ev_cron *>(this), minutes, hours, wdays, tzoff);
+        if (active)
+            start();
+    }
+
+    int set(const char *spec, int tzoff = 0) throw()
+    {
+        int active = is_active();
+        if (active)
+            stop();
+        int res = ev_cron_set_spec(static_cast<ev_cron *>(this), spec, tzoff);
+        if (active)
+            start();
+        return res;
+    }
+    EV_END_WATCHER(cron, cron)
+#endif
+
+#if EV_DEADLINE_ENABLE
+    EV_BEGIN_WATCHER(deadline, deadline)
+    void set(ev_tstamp timeout) throw()
+    {
+        int active = is_active();
+        if (active)
+            stop();
+        ev_deadline_set(static_cast<ev_deadline *>(this), timeout);
+        if (active)
+            start();
+    }
+
+    void start(ev_tstamp timeout) throw()
+    {
+        set(timeout);
+        start();
+    }
+
+    void touch() throw()
+    {
+        ev_deadline_touch(loop, static_cast<ev_deadline *>(this));
+    }
+
+    ev_tstamp remaining()
+    {
+        return ev_deadline_remaining(loop, static_cast<ev_deadline *>(this));
+    }
+    EV_END_WATCHER(deadline, deadline)
+#endif
+
 #if EV_ASYNC_ENABLE
     EV_BEGIN_WATCHER(async, async)
     void send() throw()
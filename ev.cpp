@@ -139,6 +139,7 @@ EV_USE_MONOTONIC 1
 #include <sys/types.h>
 #include <time.h>
 
+#include <atomic>
 #include <functional>
 #include <string>
 
@@ -273,10 +274,35 @@ EV_USE_MONOTONIC 1
 #endif
 #endif
 
+#ifndef EV_USE_IOURING
+#if __linux
+#define EV_USE_IOURING EV_FEATURE_BACKENDS
+#else
+#define EV_USE_IOURING 0
+#endif
+#endif
+
+#ifndef EV_USE_LINUXAIO
+#if __linux
+#define EV_USE_LINUXAIO EV_FEATURE_BACKENDS
+#else
+#define EV_USE_LINUXAIO 0
+#endif
+#endif
+
 #ifndef EV_USE_KQUEUE
 #define EV_USE_KQUEUE 0
 #endif
 
+/* select/poll后端返回后用SSE2/AVX2跳过全零的块，运行时按CPU选择 */
+#ifndef EV_USE_SIMD_SCAN
+#if (__x86_64__ || __amd64__) && (__GNUC__ >= 5 || __clang__)
+#define EV_USE_SIMD_SCAN EV_FEATURE_BACKENDS
+#else
+#define EV_USE_SIMD_SCAN 0
+#endif
+#endif
+
 #ifndef EV_USE_PORT
 #define EV_USE_PORT 0
 #endif
@@ -316,6 +342,15 @@ EV_USE_MONOTONIC 1
 #endif
 #endif
 
+// 定时器转换为文件描述符，epoll后端用它获得亚毫秒级的等待精度
+#ifndef EV_USE_TIMERFD
+#if __linux && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 8))
+#define EV_USE_TIMERFD EV_FEATURE_OS
+#else
+#define EV_USE_TIMERFD 0
+#endif
+#endif
+
 #if 0 /* debugging */
 #define EV_VERIFY 3
 #define EV_USE_4HEAP 1
@@ -334,6 +369,83 @@ EV_USE_MONOTONIC 1
 #define EV_HEAP_CACHE_AT EV_FEATURE_DATA
 #endif
 
+/* 按页分块的2叉堆(B-heap)，定时器数量大到堆放不进缓存时减少downheap的缺页和缓存缺失 */
+#ifndef EV_USE_BHEAP
+#define EV_USE_BHEAP 0
+#endif
+
+/* 4叉堆的downheap用一次向量比较选出最小的子节点，x86-64上SSE2总是可用 */
+#ifndef EV_USE_SIMD_HEAP
+#if (__x86_64__ || __amd64__) && (__GNUC__ >= 5 || __clang__)
+#define EV_USE_SIMD_HEAP EV_FEATURE_DATA
+#else
+#define EV_USE_SIMD_HEAP 0
+#endif
+#endif
+
+/* EVFLAG_LAZYTIMERS的墓碑依赖堆中缓存的at维持堆序；时间轮的停止本来就是O(1) */
+#ifndef EV_USE_LAZYTIMERS
+#define EV_USE_LAZYTIMERS EV_FEATURE_DATA
+#endif
+
+#if !EV_HEAP_CACHE_AT || EV_USE_TIMERWHEEL
+#undef EV_USE_LAZYTIMERS
+#define EV_USE_LAZYTIMERS 0
+#endif
+
+/* 向量比较要求四个子节点的at是缓存在堆数组里的double，SSE2没有64位整数的大小比较 */
+#if !EV_USE_4HEAP || !EV_HEAP_CACHE_AT || EV_USE_BHEAP || EV_TSTAMP_INT64
+#undef EV_USE_SIMD_HEAP
+#define EV_USE_SIMD_HEAP 0
+#endif
+
+/* EVFLAG_TSCCLOCK: 用rdtsc代替clock_gettime(CLOCK_MONOTONIC)，需要x86-64的不变TSC */
+#ifndef EV_USE_TSC
+#if (__x86_64__ || __amd64__) && (__GNUC__ >= 5 || __clang__) && EV_USE_MONOTONIC
+#define EV_USE_TSC EV_FEATURE_OS
+#else
+#define EV_USE_TSC 0
+#endif
+#endif
+
+/* TSC首次校准的窗口和之后重新校准的间隔(秒) */
+#ifndef EV_TSC_CALIBRATE
+#define EV_TSC_CALIBRATE 0.01
+#endif
+
+#ifndef EV_TSC_RECALIBRATE
+#define EV_TSC_RECALIBRATE 1.
+#endif
+
+/* EVFLAG_COARSE_CLOCK: 只读取内核在时钟中断时更新的时间，不访问时钟源硬件 */
+#ifndef EV_USE_COARSE_CLOCK
+#if defined(CLOCK_MONOTONIC_COARSE) && defined(CLOCK_REALTIME_COARSE) && EV_USE_MONOTONIC
+#define EV_USE_COARSE_CLOCK EV_FEATURE_OS
+#else
+#define EV_USE_COARSE_CLOCK 0
+#endif
+#endif
+
+/* ev_hrtimer默认的自旋余量(秒)，需要覆盖后端唤醒的误差和调度延迟 */
+#ifndef EV_HIRES_MARGIN
+#define EV_HIRES_MARGIN 2e-4
+#endif
+
+/* 时间跳变后每次循环迭代最多重新计算的周期定时器数量 */
+#ifndef EV_PERIODIC_CHUNK
+#define EV_PERIODIC_CHUNK 1024
+#endif
+
+/* 用分层时间轮代替ev_timer的堆，启动/停止/重置都是O(1) */
+#ifndef EV_USE_TIMERWHEEL
+#define EV_USE_TIMERWHEEL 0
+#endif
+
+/* 时间轮一格的长度(秒)，只决定定时器的分桶，定时器仍按精确的到期时刻触发 */
+#ifndef EV_TIMERWHEEL_TICK
+#define EV_TIMERWHEEL_TICK 1e-3
+#endif
+
 #ifdef ANDROID
 /* supposedly, android doesn't typedef fd_mask */
 #undef EV_USE_SELECT
@@ -375,11 +487,47 @@ EV_USE_MONOTONIC 1
 #define EV_USE_REALTIME 0
 #endif
 
+/* io_uring没有glibc封装，直接使用系统调用号 */
+#if EV_USE_IOURING
+#include <sys/syscall.h>
+#if !defined SYS_io_uring_setup && __linux && !__alpha
+#define SYS_io_uring_setup 425
+#define SYS_io_uring_enter 426
+#endif
+#ifndef SYS_io_uring_setup
+#undef EV_USE_IOURING
+#define EV_USE_IOURING 0
+#endif
+#endif
+
+/* Linux AIO同样没有glibc封装(libaio不是glibc的一部分) */
+#if EV_USE_LINUXAIO
+#include <sys/syscall.h>
+#ifndef SYS_io_submit
+#undef EV_USE_LINUXAIO
+#define EV_USE_LINUXAIO 0
+#endif
+#endif
+
+/* epoll_pwait2(linux 5.11+)同样可能没有glibc封装，不存在时运行时会得到ENOSYS */
+#if EV_USE_EPOLL
+#include <sys/syscall.h>
+#if !defined SYS_epoll_pwait2 && __linux && !__alpha
+#define SYS_epoll_pwait2 441
+#endif
+#endif
+
 #if !EV_STAT_ENABLE
 #undef EV_USE_INOTIFY
 #define EV_USE_INOTIFY 0
 #endif
 
+/* timerfd的绝对到期时刻只能以单调时钟表达 */
+#if !EV_USE_MONOTONIC
+#undef EV_USE_TIMERFD
+#define EV_USE_TIMERFD 0
+#endif
+
 #if !EV_USE_NANOSLEEP
 /* hp-ux has it in sys/time.h, which we unconditionally include above */
 #if !defined _WIN32 && !defined __hpux
@@ -438,6 +586,19 @@ struct signalfd_siginfo
 };
 #endif
 
+#if EV_USE_TIMERFD
+#include <sys/timerfd.h>
+#endif
+
+#if EV_USE_SIMD_HEAP
+#include <emmintrin.h>
+#endif
+
+#if EV_USE_TSC
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
 #if EV_VERIFY >= 3 // 调试模式
 #define EV_FREQUENT_CHECK ev_verify(loop)
 #else
@@ -716,7 +877,11 @@ static inline void *ev_realloc(void *ptr, size_t size)
 /* 在需要具体化时设置具体化 */
 #define EV_ANFD_REIFY 1
 
+/* ev_io的模式位，只有当fd上的全部监视器都请求时才对该fd生效 */
+#define EV__IOMODES (EV_ET | EV_EXCLUSIVE)
+
 /* file descriptor info structure */
+/* 只包含分发路径上读写的字段，保持在16字节以内，一条缓存行可以容纳多个fd */
 typedef struct
 {
     WL head;
@@ -724,16 +889,72 @@ typedef struct
     unsigned char reify;  /* flag set when this ANFD needs reification (EV_ANFD_REIFY, EV__IOFDSET) */
     unsigned char emask;  /* the epoll backend stores the actual kernel mask in here */
     unsigned char unused;
-#if EV_USE_EPOLL
+#if EV_USE_EPOLL || EV_USE_IOURING || EV_USE_LINUXAIO
     unsigned int egen; /* generation counter to counter epoll bugs */
 #endif
+} ANFD;
+
+static_assert(sizeof(ANFD) <= 16, "libev: ANFD must stay within 16 bytes, move cold fields to ANFDCOLD");
+
+#if EV_SELECT_IS_WINSOCKET || EV_USE_IOCP || EV_USE_LINUXAIO
+/* 只有特定后端在注册或变更时才访问的fd状态，与ANFD分开存放 */
+typedef struct
+{
 #if EV_SELECT_IS_WINSOCKET || EV_USE_IOCP
     SOCKET handle;
 #endif
 #if EV_USE_IOCP
     OVERLAPPED or, ow;
 #endif
-} ANFD;
+#if EV_USE_LINUXAIO
+    struct iocb *iocb; /* linuxaio后端中该fd的iocb，第一次注册时分配，地址固定以便io_cancel */
+#endif
+} ANFDCOLD;
+#define EV_ANFD_COLD 1
+#else
+#define EV_ANFD_COLD 0
+#endif
+
+/* anfds按页分配，每页约4KiB，页中的项数是编译期常量 */
+#define EV_ANFD_PAGESIZE (4096 / sizeof(ANFD))
+
+/*
+ * 以fd为下标的两级分页表
+ *
+ * 页目录只按最大的fd增长，页本身在第一次在其中启动ev_io时才分配，
+ * 一个很大的fd不会再迫使每个循环分配并清零一个数MB的数组。
+ * 未分配的页指向共享的全零页anfd_zero_page，因此对任意fd < anfdmax的读访问都是安全的，
+ * 只有带监视器的fd才会被写入，它们所在的页一定已经分配。
+ * 冷数据(ANFDCOLD)使用同样划分的另一组页，与热数据的页同时分配。
+ */
+typedef struct
+{
+    ANFD **pages; /* 页目录 */
+#if EV_ANFD_COLD
+    ANFDCOLD **coldpages; /* 冷数据的页目录，与pages一一对应 */
+#endif
+    int pagemax; /* 页目录的容量 */
+
+    ANFD &operator[](int fd) const
+    {
+        return pages[(unsigned)fd / EV_ANFD_PAGESIZE][(unsigned)fd % EV_ANFD_PAGESIZE];
+    }
+
+#if EV_ANFD_COLD
+    ANFDCOLD &cold(int fd) const
+    {
+        return coldpages[(unsigned)fd / EV_ANFD_PAGESIZE][(unsigned)fd % EV_ANFD_PAGESIZE];
+    }
+#endif
+} ANFDS;
+
+/* fd_reify一次迭代中产生的一项内核状态变更，整体交给backend_modify_batch */
+typedef struct
+{
+    int fd;
+    unsigned char oev; /* 变更前的事件掩码 */
+    unsigned char nev; /* 变更后的事件掩码 */
+} ANFDMOD;
 
 /* 存储给定监视器的待处理事件集 */
 typedef struct
@@ -742,6 +963,16 @@ typedef struct
     int events; /* 给定监视器的待处理事件集 */
 } ANPENDING;
 
+#if EV_ASYNC_ENABLE
+/* ev_feed_event_mt投递队列(Vyukov有界队列)的一格 */
+typedef struct
+{
+    unsigned int seq; /* 等于写入序号时可写入，等于写入序号+1时可取出 */
+    int events;
+    W w;
+} ANFEED;
+#endif
+
 #if EV_USE_INOTIFY
 /* hash table entry per inotify-id */
 typedef struct
@@ -755,7 +986,7 @@ typedef struct
 /* a heap element */
 typedef struct
 {
-    ev_tstamp at;
+    ev_timekey at;
     WT w;
 } ANHE;
 
@@ -771,6 +1002,33 @@ typedef WT ANHE;
 #define ANHE_at_cache(he)
 #endif
 
+#if EV_USE_TIMERWHEEL
+/* 每层的槽数和层数，4层共覆盖2**32格 */
+#define EV_TIMERWHEEL_BITS 8
+#define EV_TIMERWHEEL_SLOTS (1 << EV_TIMERWHEEL_BITS)
+#define EV_TIMERWHEEL_MASK (EV_TIMERWHEEL_SLOTS - 1)
+#define EV_TIMERWHEEL_LEVELS 4
+
+/* timers中同一下标的定时器在时间轮槽链表中的链接 */
+typedef struct
+{
+    int next; /* 同一槽中的下一项在timers中的下标，0表示没有 */
+    int prev; /* 同一槽中的上一项，0表示它是链表头 */
+    int slot; /* 所在的槽(层 * EV_TIMERWHEEL_SLOTS + 槽号)，-1表示不在任何槽中 */
+} ANTW;
+#endif
+
+#if EV_DEADLINE_ENABLE
+/* timeout相同的ev_deadline组成一个组，按最后活动时间排队，只有队首占用一个定时器 */
+typedef struct
+{
+    ev_tstamp timeout;        /* 组内所有监视器的timeout */
+    ev_deadline *head, *tail; /* 最早和最晚活动的监视器 */
+    int index;                /* 在deadlinegroups中的下标 */
+    ev_timer timer;           /* 不早于队首的超时时刻，组不为空时始终激活 */
+} ANDL;
+#endif
+
 #if EV_MULTIPLICITY
 
 #include "ev_wrap.h"
@@ -826,16 +1084,191 @@ ev_tstamp ev_time(void) noexcept
 }
 #endif
 
-static inline ev_tstamp get_clock()
+/* 单调时钟，EV_TSTAMP_INT64时直接由timespec得到整数纳秒 */
+static inline ev_timekey get_clock()
 {
 #if EV_USE_MONOTONIC
     if (have_monotonic) [[likely]]
     {
         struct timespec ts;
         clock_gettime(CLOCK_MONOTONIC, &ts);
+#if EV_TSTAMP_INT64
+        return ts.tv_sec * (ev_timekey)1000000000 + ts.tv_nsec;
+#else
         return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+    }
+#endif
+    return EV_TS2KEY(ev_time());
+}
+
+#if EV_USE_COARSE_CLOCK
+static inline ev_timekey coarse_clock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#if EV_TSTAMP_INT64
+    return ts.tv_sec * (ev_timekey)1000000000 + ts.tv_nsec;
+#else
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+static inline ev_tstamp coarse_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* EVFLAG_COARSE_CLOCK且内核支持*_COARSE时钟时让循环改用它们，EVFLAG_TSCCLOCK随之失效 */
+__cold static void coarse_init(struct ev_loop *loop, unsigned int flags)
+{
+    struct timespec ts;
+
+    clock_coarse = (flags & EVFLAG_COARSE_CLOCK) && have_monotonic
+                   && !clock_gettime(CLOCK_MONOTONIC_COARSE, &ts)
+                   && !clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+}
+#endif
+
+#if EV_USE_TSC
+/* cpuid 0x80000007 EDX第8位: TSC以恒定频率运行，不受变频和深度睡眠影响 */
+__cold static int tsc_invariant()
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+        return 0;
+
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+
+    return !!(edx & (1U << 8));
+}
+
+/*
+ * 同时读取TSC和单调时钟
+ * @param tsc 返回与单调时钟对应的TSC读数
+ * @return 单调时钟
+ *
+ * 以前后两次rdtsc的中点作为clock_gettime的时刻，取三次中间隔最短的一次，
+ * 减小被抢占或中断对校准的影响。
+ */
+static ev_timekey tsc_sample(uint64_t *tsc)
+{
+    uint64_t best = ~(uint64_t)0;
+    ev_timekey mn = 0;
+    int i;
+
+    for (i = 3; i--;)
+    {
+        uint64_t t0 = __rdtsc();
+        ev_timekey now = get_clock();
+        uint64_t t1 = __rdtsc();
+
+        if (t1 - t0 < best)
+        {
+            best = t1 - t0;
+            *tsc = t0 + (t1 - t0) / 2;
+            mn = now;
+        }
+    }
+
+    return mn;
+}
+
+/* EVFLAG_TSCCLOCK且CPU有不变TSC时记录首次校准的起点，之后的EV_TSC_CALIBRATE秒内仍使用clock_gettime */
+__cold static void tsc_init(struct ev_loop *loop, unsigned int flags)
+{
+    tsc_base = 0;
+    tsc_scale = 0.;
+
+    if (!(flags & EVFLAG_TSCCLOCK) || (flags & EVFLAG_COARSE_CLOCK) || !have_monotonic || !tsc_invariant())
+        return;
+
+    tsc_mn_base = tsc_sample(&tsc_base);
+    tsc_recal_at = tsc_mn_base + EV_TS2KEY(EV_TSC_CALIBRATE);
+}
+
+/*
+ * 校准TSC，由loop_clock在首次校准窗口内或到达重新校准时刻时调用
+ * @param loop 事件循环实例
+ * @return 单调时钟
+ *
+ * 以上次校准点到现在的TSC增量和单调时钟增量重新计算比例，并把当前点作为新的基准。
+ * TSC倒退或比例与上次相差超过千分之一时(非同步的多核TSC、虚拟机迁移、挂起恢复等)，
+ * 认为TSC不可靠，之后一直使用clock_gettime。
+ */
+static ev_timekey noinline tsc_calibrate(struct ev_loop *loop)
+{
+    uint64_t tsc;
+    ev_timekey mn = tsc_sample(&tsc);
+    double scale;
+
+    if (!tsc_scale && mn < tsc_recal_at)
+        return mn;
+
+    if (tsc <= tsc_base || mn <= tsc_mn_base)
+    {
+        tsc_base = 0;
+        tsc_scale = 0.;
+        return mn;
+    }
+
+    scale = (double)(mn - tsc_mn_base) / (double)(tsc - tsc_base);
+
+    if (tsc_scale && (scale > tsc_scale * 1.001 || scale < tsc_scale * 0.999))
+    {
+        tsc_base = 0;
+        tsc_scale = 0.;
+        return mn;
+    }
+
+    /* 外推的时间可能略微超前于真实的单调时钟，新的基准不早于上次返回的时间 */
+    if (mn < mn_now)
+        mn = mn_now;
+
+    tsc_scale = scale;
+    tsc_base = tsc;
+    tsc_mn_base = mn;
+    tsc_recal_at = mn + EV_TS2KEY(EV_TSC_RECALIBRATE);
+
+    return mn;
+}
+#endif
+
+/* 循环使用的单调时钟，粗粒度模式下读*_COARSE时钟，TSC校准完成后由TSC外推，否则与get_clock相同 */
+static inline ev_timekey loop_clock(struct ev_loop *loop)
+{
+#if EV_USE_COARSE_CLOCK
+    if (clock_coarse) [[unlikely]]
+        return coarse_clock();
+#endif
+
+#if EV_USE_TSC
+    if (tsc_scale) [[likely]]
+    {
+        ev_timekey now = tsc_mn_base + (ev_timekey)((double)(int64_t)(__rdtsc() - tsc_base) * tsc_scale);
+
+        if (now < tsc_recal_at) [[likely]]
+            return now;
     }
+
+    if (tsc_base)
+        return tsc_calibrate(loop);
+#endif
+
+    return get_clock();
+}
+
+/* 循环使用的实时时钟 */
+static inline ev_tstamp loop_time(struct ev_loop *loop)
+{
+#if EV_USE_COARSE_CLOCK
+    if (clock_coarse) [[unlikely]]
+        return coarse_time();
 #endif
+
     return ev_time();
 }
 
@@ -975,9 +1408,82 @@ static inline void queue_events(struct ev_loop *loop, W *events, int eventcnt, i
 
 /*****************************************************************************/
 
+/* 所有循环共享的全零页，未分配的页都指向它，只会被读取 */
+static ANFD anfd_zero_page[EV_ANFD_PAGESIZE];
+#if EV_ANFD_COLD
+static ANFDCOLD anfd_zero_coldpage[EV_ANFD_PAGESIZE];
+#endif
+
+/*
+ * 确保fd所在的页已经分配
+ * @param loop 事件循环实例
+ * @param fd 将要启动ev_io的文件描述符
+ *
+ * 页目录按array_realloc的策略增长，新的目录项指向全零页；
+ * fd所在的页仍是全零页时才分配并清零真正的页。
+ */
+static void noinline anfds_needsize(struct ev_loop *loop, int fd)
+{
+    int page = (unsigned)fd / EV_ANFD_PAGESIZE;
+
+    if (expect_false(page >= anfds.pagemax))
+    {
+        int ocur = anfds.pagemax;
+
+        anfds.pages = (ANFD **)array_realloc(sizeof(ANFD *), anfds.pages, &anfds.pagemax, page + 1);
+#if EV_ANFD_COLD
+        anfds.coldpages = (ANFDCOLD **)ev_realloc(anfds.coldpages, sizeof(ANFDCOLD *) * anfds.pagemax);
+#endif
+
+        for (; ocur < anfds.pagemax; ++ocur)
+        {
+            anfds.pages[ocur] = anfd_zero_page;
+#if EV_ANFD_COLD
+            anfds.coldpages[ocur] = anfd_zero_coldpage;
+#endif
+        }
+
+        anfdmax = anfds.pagemax * EV_ANFD_PAGESIZE;
+    }
+
+    if (expect_false(anfds.pages[page] == anfd_zero_page))
+    {
+        anfds.pages[page] = (ANFD *)ev_malloc(sizeof(ANFD) * EV_ANFD_PAGESIZE);
+        array_init_zero(anfds.pages[page], EV_ANFD_PAGESIZE);
+#if EV_ANFD_COLD
+        anfds.coldpages[page] = (ANFDCOLD *)ev_malloc(sizeof(ANFDCOLD) * EV_ANFD_PAGESIZE);
+        array_init_zero(anfds.coldpages[page], EV_ANFD_PAGESIZE);
+#endif
+    }
+}
+
+/* 释放全部已分配的页和页目录 */
+static void anfds_free(struct ev_loop *loop)
+{
+    int page;
+
+    for (page = 0; page < anfds.pagemax; ++page)
+        if (anfds.pages[page] != anfd_zero_page)
+        {
+            ev_free(anfds.pages[page]);
+#if EV_ANFD_COLD
+            ev_free(anfds.coldpages[page]);
+#endif
+        }
+
+    ev_free(anfds.pages);
+    anfds.pages = 0;
+#if EV_ANFD_COLD
+    ev_free(anfds.coldpages);
+    anfds.coldpages = 0;
+#endif
+    anfds.pagemax = 0;
+    anfdmax = 0;
+}
+
 static inline void fd_event_nocheck(struct ev_loop *loop, int fd, int revents)
 {
-    ANFD *anfd = anfds + fd;
+    ANFD *anfd = &anfds[fd];
     ev_io *w;
 
     for (w = (ev_io *)anfd->head; w; w = (ev_io *)((WL)w)->next)
@@ -993,7 +1499,7 @@ static inline void fd_event_nocheck(struct ev_loop *loop, int fd, int revents)
 /* because that means they changed while we were polling for new events */
 static inline void fd_event(struct ev_loop *loop, int fd, int revents)
 {
-    ANFD *anfd = anfds + fd;
+    ANFD *anfd = &anfds[fd];
 
     if (expect_true(!anfd->reify))
         fd_event_nocheck(loop, fd, revents);
@@ -1015,13 +1521,13 @@ static inline void fd_reify(struct ev_loop *loop)
     for (i = 0; i < fdchangecnt; ++i)
     {
         int fd = fdchanges[i];
-        ANFD *anfd = anfds + fd;
+        ANFD *anfd = &anfds[fd];
 
         if (anfd->reify & EV__IOFDSET && anfd->head)
         {
             SOCKET handle = EV_FD_TO_WIN32_HANDLE(fd);
 
-            if (handle != anfd->handle)
+            if (handle != anfds.cold(fd).handle)
             {
                 unsigned long arg;
 
@@ -1030,18 +1536,26 @@ static inline void fd_reify(struct ev_loop *loop)
                 /* handle changed, but fd didn't - we need to do it in two steps */
                 backend_modify(loop, fd, anfd->events, 0);
                 anfd->events = 0;
-                anfd->handle = handle;
+                anfds.cold(fd).handle = handle;
             }
         }
     }
 #endif
 
+    /* 一次迭代最多为每个变更的fd产生一项变更，预先分配好批量数组 */
+    if (backend_modify_batch)
+        array_needsize(ANFDMOD, fdmods, fdmodmax, fdchangecnt, EMPTY2);
+
     for (i = 0; i < fdchangecnt; ++i)
     {
         int fd = fdchanges[i];
-        ANFD *anfd = anfds + fd;
+        ANFD *anfd = &anfds[fd];
         ev_io *w;
 
+        /* fdchanges中的fd通常是分散的，提前预取后面的anfds项以隐藏缓存未命中 */
+        if (i + 4 < fdchangecnt)
+            ecb_prefetch(&anfds[fdchanges[i + 4]], 1, 1);
+
         unsigned char o_events = anfd->events;
         unsigned char o_reify = anfd->reify;
 
@@ -1049,20 +1563,50 @@ static inline void fd_reify(struct ev_loop *loop)
 
         /*if (expect_true (o_reify & EV_ANFD_REIFY)) probably a deoptimisation */
         {
+            unsigned char modes = EV__IOMODES;
+
             anfd->events = 0;
 
             for (w = (ev_io *)anfd->head; w; w = (ev_io *)((WL)w)->next)
+            {
                 anfd->events |= (unsigned char)w->events;
+                modes &= (unsigned char)w->events;
+            }
 
-            if (o_events != anfd->events)
+            /* 混用时退回水平触发，否则不要求边沿触发的监视器会丢失事件 */
+            anfd->events &= (unsigned char)~EV__IOMODES | modes;
+
+            /*
+             * 后端以边沿触发注册了双向兴趣时(emask带EV_ET)，去掉某个方向无需通知后端；
+             * 新增方向仍要通知，让后端重新检查就绪状态，此前该方向的边沿已被fd_event丢弃
+             */
+            if (o_events != anfd->events
+                && !(o_events & anfd->events & EV_ET && anfd->emask & EV_ET
+                     && !(anfd->events & ~o_events & (EV_READ | EV_WRITE))))
                 o_reify = EV__IOFDSET; /* actually |= */
         }
 
         if (o_reify & EV__IOFDSET)
-            backend_modify(loop, fd, o_events, anfd->events);
+        {
+            if (backend_modify_batch)
+            {
+                fdmods[fdmodcnt].fd = fd;
+                fdmods[fdmodcnt].oev = o_events;
+                fdmods[fdmodcnt].nev = anfd->events;
+                ++fdmodcnt;
+            }
+            else
+                backend_modify(loop, fd, o_events, anfd->events);
+        }
     }
 
     fdchangecnt = 0;
+
+    if (fdmodcnt)
+    {
+        backend_modify_batch(loop, fdmods, fdmodcnt);
+        fdmodcnt = 0;
+    }
 }
 
 /* something about the given fd changed */
@@ -1160,34 +1704,144 @@ static inline void fd_intern(int fd)
  */
 
 /*
- * 目前我们允许libev使用两种堆：
+ * 目前我们允许libev使用三种堆：
  * 一种是代码量较小的2叉堆，
  * 另一种是体积约大1.5kb但缓存效率更高的4叉堆。
  * 在监控器数量超过50000时，两者性能差异约为5%。
+ * 第三种是EV_USE_BHEAP的B-heap，只在堆远大于缓存时才有意义。
  */
 
-#if EV_USE_4HEAP
+#if EV_USE_BHEAP
 
-#define DHEAP 4
-#define HEAP0 (DHEAP - 1) /* index of first element in heap */
-#define HPARENT(k) ((((k) - HEAP0 - 1) / DHEAP) + HEAP0)
-#define UPHEAP_DONE(p, k) ((p) == (k))
+/*
+ * B-heap (Poul-Henning Kamp)：仍是2叉堆，但每个子树按块(默认一页)存放，
+ * 从根到叶的一次downheap只跨越O(log_B n)个块，而不是O(log n)个。
+ * 下标仍从HEAP0开始连续使用，所以堆数组的其余用法与2叉堆相同。
+ * 块内除第0块外的前两个位置各只有一个子节点；块的最后一行的子节点在下一层的块中。
+ * 父节点的下标不随子节点单调增长，reheap要从最后一个元素开始。
+ */
+#ifndef EV_BHEAP_SHIFT
+#define EV_BHEAP_SHIFT (EV_HEAP_CACHE_AT ? 8 : 9) /* 每块1 << EV_BHEAP_SHIFT个元素 */
+#endif
+#define BHEAP_SIZE (1 << EV_BHEAP_SHIFT)
+#define BHEAP_MASK (BHEAP_SIZE - 1)
 
-/* away from the root */
-static inline void downheap(ANHE *heap, int N, int k)
+#define HEAP0 1
+#define UPHEAP_DONE(p, k) (!(p))
+#define REHEAP_FIRST(N) ((N) + HEAP0 - 1)
+
+static inline int bheap_parent(int k)
 {
-    ANHE he = heap[k];
-    ANHE *E = heap + N + HEAP0;
+    int o = k & BHEAP_MASK;
+    int p;
 
-    for (;;)
+    if (k < BHEAP_SIZE || o > 3)
+        /* 块内的普通节点 */
+        p = (k & ~BHEAP_MASK) | (o >> 1);
+    else if (o < 2)
     {
-        ev_tstamp minat;
-        ANHE *minpos;
-        ANHE *pos = heap + DHEAP * (k - HEAP0) + HEAP0 + 1;
+        /* 块的前两个位置，父节点在上一层块的最后一行 */
+        p = (k - BHEAP_SIZE) >> EV_BHEAP_SHIFT;
+        p += p & ~(BHEAP_MASK >> 1);
+        p |= BHEAP_SIZE / 2;
+    }
+    else
+        /* 块内第2、3个位置的父节点是前两个位置 */
+        p = k - 2;
 
-        /* find minimum child */
-        if (expect_true(pos + DHEAP - 1 < E))
-        {
+    return p;
+}
+
+#define HPARENT(k) bheap_parent(k)
+
+/* 第一个子节点的下标，*two为0时没有第二个子节点；用64位计算，堆很大时也不会溢出 */
+static inline uint64_t bheap_child(int k, int *two)
+{
+    uint64_t c;
+
+    *two = 1;
+
+    if (k > BHEAP_MASK && !(k & (BHEAP_MASK - 1)))
+    {
+        *two = 0;
+        c = k + 2;
+    }
+    else if (k & (BHEAP_SIZE >> 1))
+    {
+        c = (uint64_t)((((k & ~BHEAP_MASK) >> 1) | (k & (BHEAP_MASK >> 1))) + 1) << EV_BHEAP_SHIFT;
+    }
+    else
+        c = k + (k & BHEAP_MASK);
+
+    return c;
+}
+
+/* away from the root */
+static inline void downheap(ANHE *heap, int N, int k)
+{
+    ANHE he = heap[k];
+    uint64_t E = N + HEAP0;
+
+    for (;;)
+    {
+        int two;
+        uint64_t c = bheap_child(k, &two);
+
+        if (c >= E)
+            break;
+
+        c += two && c + 1 < E && ANHE_at(heap[c]) > ANHE_at(heap[c + 1]) ? 1 : 0;
+
+        if (ANHE_at(he) <= ANHE_at(heap[c]))
+            break;
+
+        heap[k] = heap[c];
+        ev_active(ANHE_w(heap[k])) = k;
+
+        k = (int)c;
+    }
+
+    heap[k] = he;
+    ev_active(ANHE_w(he)) = k;
+}
+
+#elif EV_USE_4HEAP
+
+#define DHEAP 4
+#define HEAP0 (DHEAP - 1) /* index of first element in heap */
+#define HPARENT(k) ((((k) - HEAP0 - 1) / DHEAP) + HEAP0)
+#define UPHEAP_DONE(p, k) ((p) == (k))
+#define REHEAP_FIRST(N) HPARENT((N) + HEAP0 - 1)
+
+/* away from the root */
+static inline void downheap(ANHE *heap, int N, int k)
+{
+    ANHE he = heap[k];
+    ANHE *E = heap + N + HEAP0;
+
+    for (;;)
+    {
+        ev_tstamp minat;
+        ANHE *minpos;
+        ANHE *pos = heap + DHEAP * (k - HEAP0) + HEAP0 + 1;
+
+        /* find minimum child */
+        if (expect_true(pos + DHEAP - 1 < E))
+        {
+#if EV_USE_SIMD_HEAP
+            /*
+             * 四个子节点总是从4的倍数处连续存放，一次取出四个at求最小值，
+             * 再用相等比较的掩码找出位置。随机的超时时间下这里没有难以预测的分支，
+             * 相等时取最靠前的子节点，与标量版本一致
+             */
+            __m128d a = _mm_loadh_pd(_mm_load_sd(&ANHE_at(pos[0])), &ANHE_at(pos[1]));
+            __m128d b = _mm_loadh_pd(_mm_load_sd(&ANHE_at(pos[2])), &ANHE_at(pos[3]));
+            __m128d m = _mm_min_pd(a, b);
+
+            m = _mm_min_pd(m, _mm_shuffle_pd(m, m, 1));
+            minat = _mm_cvtsd_f64(m);
+            minpos = pos + ecb_ctz32(_mm_movemask_pd(_mm_cmpeq_pd(a, m)) | _mm_movemask_pd(_mm_cmpeq_pd(b, m)) << 2);
+#else
             /* fast path */ (minpos = pos + 0), (minat = ANHE_at(*minpos));
             if (ANHE_at(pos[1]) < minat)
                 (minpos = pos + 1), (minat = ANHE_at(*minpos));
@@ -1195,6 +1849,7 @@ static inline void downheap(ANHE *heap, int N, int k)
                 (minpos = pos + 2), (minat = ANHE_at(*minpos));
             if (ANHE_at(pos[3]) < minat)
                 (minpos = pos + 3), (minat = ANHE_at(*minpos));
+#endif
         }
         else if (pos < E)
         {
@@ -1227,6 +1882,7 @@ static inline void downheap(ANHE *heap, int N, int k)
 #define HEAP0 1
 #define HPARENT(k) ((k) >> 1)
 #define UPHEAP_DONE(p, k) (!(p))
+#define REHEAP_FIRST(N) HPARENT((N) + HEAP0 - 1)
 
 /* away from the root */
 static inline void downheap(ANHE *heap, int N, int k)
@@ -1286,15 +1942,261 @@ static inline void adjustheap(ANHE *heap, int N, int k)
         downheap(heap, N, k);
 }
 
-/* rebuild the heap: this function is used only once and executed rarely */
+/*
+ * rebuild the heap bottom-up (floyd), O(N)
+ * 从REHEAP_FIRST开始向根逐个downheap，子节点的下标总比父节点大，所以对各种堆都成立。
+ * 叶子不会被移动，所以调用前它们的ev_active必须已经是自己的下标
+ */
 static inline void reheap(ANHE *heap, int N)
+{
+    int k;
+
+    if (N < 2)
+        return;
+
+    for (k = REHEAP_FIRST(N); k >= HEAP0; --k)
+        downheap(heap, N, k);
+}
+
+#if EV_USE_TIMERWHEEL
+/*
+ * 分层时间轮
+ *
+ * 定时器仍存放在timers[HEAP0..timercnt+HEAP0)中(不再有堆序)，ev_active是它的下标，
+ * timerlinks中同一下标的项把它挂在某个槽的双向链表上，启动、停止和重置都是O(1)。
+ * 第0层每格EV_TIMERWHEEL_TICK，每高一层每格是下一层的一整圈；
+ * 定时器按到期的格与timerwheel_tick的距离放入能容纳它的最低层，
+ * 第0层转完一圈时把上一层的下一个槽重新分配到下面的层中(Linux内核的经典做法)。
+ * 槽只决定何时检查定时器，是否到期仍按精确的at判断，同一格中的定时器按at排序后触发。
+ */
+
+#if EV_TSTAMP_INT64
+#define EV_TIMERWHEEL_TICK_NS ((int64_t)(EV_TIMERWHEEL_TICK * 1e9 + .5))
+
+/* 到期时刻所在的格，整数纳秒直接向下取整相除 */
+static inline int64_t timerwheel_tickof(ev_timekey at)
+{
+    int64_t tick = at / EV_TIMERWHEEL_TICK_NS;
+
+    return tick - (at < tick * EV_TIMERWHEEL_TICK_NS);
+}
+
+/* 格的起始时刻 */
+#define timerwheel_keyof(tick) ((tick) * EV_TIMERWHEEL_TICK_NS)
+#else
+/* 到期时刻所在的格，超出范围的值被截断，避免转换溢出 */
+static inline int64_t timerwheel_tickof(ev_timekey at)
+{
+    ev_tstamp t = at * (1. / EV_TIMERWHEEL_TICK);
+    int64_t tick;
+
+    if (expect_false(t > 4e18))
+        t = 4e18;
+    else if (expect_false(t < -4e18))
+        t = -4e18;
+
+    /* 转换向零取整，负数需要再减一才是向下取整 */
+    tick = (int64_t)t;
+    return tick - (t < (ev_tstamp)tick);
+}
+
+/* 格的起始时刻 */
+#define timerwheel_keyof(tick) ((tick) * EV_TIMERWHEEL_TICK)
+#endif
+
+/* 返回level层中从from开始第一个非空槽的槽号，没有则返回EV_TIMERWHEEL_SLOTS */
+static int timerwheel_find(struct ev_loop *loop, int level, int from)
+{
+    const uint64_t *bits = timerwheel_bits + level * (EV_TIMERWHEEL_SLOTS / 64);
+    int word = from / 64;
+    uint64_t mask;
+
+    if (from >= EV_TIMERWHEEL_SLOTS)
+        return EV_TIMERWHEEL_SLOTS;
+
+    mask = bits[word] & (~(uint64_t)0 << (from % 64));
+
+    for (;;)
+    {
+        if (mask)
+            return word * 64 + ecb_ctz64(mask);
+
+        if (++word == EV_TIMERWHEEL_SLOTS / 64)
+            return EV_TIMERWHEEL_SLOTS;
+
+        mask = bits[word];
+    }
+}
+
+/* 返回到期时刻at在时间轮中对应的槽 */
+static inline int timerwheel_slot(struct ev_loop *loop, ev_timekey at)
+{
+    int64_t tick = timerwheel_tickof(at);
+    int64_t delta = tick - timerwheel_tick;
+    int level = 0;
+
+    /* 已经过期的放在当前槽，超出最高层范围的先放在最高层的最远处，级联时再重新分配 */
+    if (delta < 0)
+        tick = timerwheel_tick;
+    else if (delta >= (int64_t)1 << (EV_TIMERWHEEL_BITS * EV_TIMERWHEEL_LEVELS))
+        tick = timerwheel_tick + ((int64_t)1 << (EV_TIMERWHEEL_BITS * EV_TIMERWHEEL_LEVELS)) - 1;
+
+    while (level < EV_TIMERWHEEL_LEVELS - 1 && delta >= (int64_t)1 << (EV_TIMERWHEEL_BITS * (level + 1)))
+        ++level;
+
+    return level * EV_TIMERWHEEL_SLOTS + (int)((tick >> (EV_TIMERWHEEL_BITS * level)) & EV_TIMERWHEEL_MASK);
+}
+
+/* 把timers[i]挂到与它的到期时刻对应的槽上 */
+static void timerwheel_link(struct ev_loop *loop, int i)
+{
+    ANTW *l = timerlinks + i;
+
+    l->slot = timerwheel_slot(loop, ANHE_at(timers[i]));
+    l->prev = 0;
+    l->next = timerwheel[l->slot];
+
+    if (l->next)
+        timerlinks[l->next].prev = i;
+
+    timerwheel[l->slot] = i;
+    timerwheel_bits[l->slot / 64] |= (uint64_t)1 << (l->slot % 64);
+}
+
+/* 把timers[i]从它所在的槽上摘下 */
+static void timerwheel_unlink(struct ev_loop *loop, int i)
+{
+    ANTW *l = timerlinks + i;
+
+    if (l->slot < 0)
+        return;
+
+    if (l->prev)
+        timerlinks[l->prev].next = l->next;
+    else
+        timerwheel[l->slot] = l->next;
+
+    if (l->next)
+        timerlinks[l->next].prev = l->prev;
+
+    if (!timerwheel[l->slot])
+        timerwheel_bits[l->slot / 64] &= ~((uint64_t)1 << (l->slot % 64));
+
+    l->slot = -1;
+}
+
+/* 把timers[from]移动到空出的timers[to]，保持链表和ev_active一致 */
+static void timerwheel_move(struct ev_loop *loop, int from, int to)
+{
+    ANTW *l = timerlinks + to;
+
+    timers[to] = timers[from];
+    *l = timerlinks[from];
+    ev_active(ANHE_w(timers[to])) = to;
+
+    if (l->slot >= 0)
+    {
+        if (l->prev)
+            timerlinks[l->prev].next = to;
+        else
+            timerwheel[l->slot] = to;
+
+        if (l->next)
+            timerlinks[l->next].prev = to;
+    }
+}
+
+/* 把level层当前的槽重新分配到下面的层中，返回该槽的槽号 */
+static int timerwheel_cascade(struct ev_loop *loop, int level)
+{
+    int idx = (int)((timerwheel_tick >> (EV_TIMERWHEEL_BITS * level)) & EV_TIMERWHEEL_MASK);
+    int slot = level * EV_TIMERWHEEL_SLOTS + idx;
+    int i = timerwheel[slot];
+
+    timerwheel[slot] = 0;
+    timerwheel_bits[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+
+    while (i)
+    {
+        int next = timerlinks[i].next;
+
+        timerwheel_link(loop, i);
+        i = next;
+    }
+
+    return idx;
+}
+
+/* 清空时间轮，以tick为当前格重新挂上全部定时器，用于时间跳变后 */
+static void noinline __cold timerwheel_rebuild(struct ev_loop *loop, int64_t tick)
 {
     int i;
 
-    /* we don't use floyds algorithm, upheap is simpler and is more cache-efficient */
-    /* also, this is easy to implement and correct for both 2-heaps and 4-heaps */
-    for (i = 0; i < N; ++i)
-        upheap(heap, i + HEAP0);
+    memset(timerwheel, 0, sizeof(timerwheel));
+    memset(timerwheel_bits, 0, sizeof(timerwheel_bits));
+    timerwheel_tick = tick;
+
+    for (i = HEAP0; i < timercnt + HEAP0; ++i)
+        timerwheel_link(loop, i);
+}
+#endif
+
+/*
+ * 返回最早的ev_timer到期时刻，调用者保证timercnt不为0
+ * @param loop 事件循环实例
+ *
+ * 堆直接返回堆顶。时间轮在第0层本圈内有定时器时返回第一个非空槽中精确的最小at；
+ * 否则返回各层下一个非空槽覆盖范围的起始时刻中最早的一个，这是一个下界，
+ * 最坏情况下每个定时器在每一层各提前唤醒一次，随后它被级联到更低的层。
+ */
+static inline ev_timekey timers_next_at(struct ev_loop *loop)
+{
+#if EV_USE_TIMERWHEEL
+    int idx = (int)(timerwheel_tick & EV_TIMERWHEEL_MASK);
+    int slot = timerwheel_find(loop, 0, idx);
+    int64_t next = INT64_MAX;
+    int level;
+
+    if (slot < EV_TIMERWHEEL_SLOTS)
+    {
+        ev_timekey at = ANHE_at(timers[timerwheel[slot]]);
+        int i;
+
+        for (i = timerlinks[timerwheel[slot]].next; i; i = timerlinks[i].next)
+            if (ANHE_at(timers[i]) < at)
+                at = ANHE_at(timers[i]);
+
+        return at;
+    }
+
+    /* 第0层下一圈的槽 */
+    slot = timerwheel_find(loop, 0, 0);
+    if (slot < idx)
+        next = (timerwheel_tick | EV_TIMERWHEEL_MASK) + 1 + slot;
+
+    for (level = 1; level < EV_TIMERWHEEL_LEVELS; ++level)
+    {
+        int shift = EV_TIMERWHEEL_BITS * level;
+        int cur = (int)((timerwheel_tick >> shift) & EV_TIMERWHEEL_MASK);
+        int dist;
+
+        /* 当前槽已经在本圈开始时级联过，其中的定时器属于再下一圈，最后考虑 */
+        slot = timerwheel_find(loop, level, cur + 1);
+        if (slot < EV_TIMERWHEEL_SLOTS)
+            dist = slot - cur;
+        else if ((slot = timerwheel_find(loop, level, 0)) <= cur)
+            dist = slot + EV_TIMERWHEEL_SLOTS - cur;
+        else
+            continue;
+
+        if (((timerwheel_tick >> shift) + dist) << shift < next)
+            next = ((timerwheel_tick >> shift) + dist) << shift;
+    }
+
+    return timerwheel_keyof(next);
+#else
+    return ANHE_at(timers[HEAP0]);
+#endif
 }
 
 /*****************************************************************************/
@@ -1401,6 +2303,31 @@ static inline void evpipe_write(struct ev_loop *loop, EV_ATOMIC_T *flag)
     }
 }
 
+#if EV_ASYNC_ENABLE
+/* 把其他线程用ev_feed_event_mt投递的事件移到pendings中 */
+static void feedmt_drain(struct ev_loop *loop)
+{
+    unsigned int n;
+
+    /* 最多取一圈，投递线程持续写入时也不会一直停在这里 */
+    for (n = feedmtmask + 1; n--;)
+    {
+        ANFEED *cell = feedmt + (feedmttail & feedmtmask);
+
+        if (std::atomic_ref<unsigned int>(cell->seq).load(std::memory_order_acquire) != feedmttail + 1)
+            return;
+
+        ev_feed_event(loop, cell->w, cell->events);
+        std::atomic_ref<unsigned int>(cell->seq).store(feedmttail + feedmtmask + 1, std::memory_order_release);
+        ++feedmttail;
+    }
+
+    /* 取完一圈后下一格已经写好，说明还有剩余，下一次迭代不阻塞，继续取 */
+    if (std::atomic_ref<unsigned int>(feedmt[feedmttail & feedmtmask].seq).load(std::memory_order_acquire) == feedmttail + 1)
+        evpipe_write(loop, &feedmt_pending);
+}
+#endif
+
 /* 每当libev信号管道被调用时触发 */
 /* 接收到某些事件（信号、异步事件） */
 static void pipecb(struct ev_loop *loop, ev_io *iow, int revents)
@@ -1464,6 +2391,15 @@ static void pipecb(struct ev_loop *loop, ev_io *iow, int revents)
                 ev_feed_event(loop, asyncs[i], EV_ASYNC);
             }
     }
+
+    if (feedmt_pending)
+    {
+        feedmt_pending = 0;
+
+        ECB_MEMORY_FENCE;
+
+        feedmt_drain(loop);
+    }
 #endif
 }
 
@@ -1605,6 +2541,15 @@ static void childcb(struct ev_loop *loop, ev_signal *sw, int revents)
 #if EV_USE_EPOLL
 #include "ev_epoll.c"
 #endif
+#if EV_USE_IOURING
+#include "ev_iouring.c"
+#endif
+#if EV_USE_LINUXAIO
+#include "ev_linuxaio.c"
+#endif
+#if EV_USE_POLL || EV_USE_SELECT
+#include "ev_scan.c"
+#endif
 #if EV_USE_POLL
 #include "ev_poll.c"
 #endif
@@ -1642,6 +2587,10 @@ unsigned int __cold ev_supported_backends(void) noexcept
         flags |= EVBACKEND_KQUEUE;
     if (EV_USE_EPOLL)
         flags |= EVBACKEND_EPOLL;
+    if (EV_USE_IOURING && ev_linux_version() >= 0x050600) /* POLL_ADD/TIMEOUT/NODROP */
+        flags |= EVBACKEND_IOURING;
+    if (EV_USE_LINUXAIO && ev_linux_version() >= 0x041300) /* IOCB_CMD_POLL, reliable since 4.19 */
+        flags |= EVBACKEND_LINUXAIO;
     if (EV_USE_POLL)
         flags |= EVBACKEND_POLL;
     if (EV_USE_SELECT)
@@ -1654,6 +2603,9 @@ unsigned int __cold ev_recommended_backends(void) noexcept
 {
     unsigned int flags = ev_supported_backends();
 
+    /* 同时在内核中的请求数受环大小和aio-max-nr限制，只在显式请求时使用 */
+    flags &= ~EVBACKEND_LINUXAIO;
+
 #ifndef __NetBSD__
     /* kqueue is borked on everything but netbsd apparently */
     /* it usually doesn't work correctly on anything but sockets and pipes */
@@ -1707,6 +2659,36 @@ void ev_set_timeout_collect_interval(struct ev_loop *loop, ev_tstamp interval) n
     timeout_blocktime = interval;
 }
 
+void ev_set_busy_poll(struct ev_loop *loop, ev_tstamp budget) noexcept
+{
+    busy_poll = budget > 0. ? budget : 0.;
+
+#if EV_USE_EPOLL
+    /* 让内核在epoll_wait中也忙轮询网卡队列(linux 6.9+)，旧内核忽略 */
+    if (backend == EVBACKEND_EPOLL)
+        epoll_busy_poll_params(loop);
+#endif
+}
+
+/*
+ * 设置定时器松弛时间
+ * 每个定时器可以在[at, at + slack]内触发，循环等到最早的定时器窗口的末尾才醒来，
+ * 此前到期的定时器都在这一次唤醒中处理。适用于ev_timer和ev_periodic
+ * @param loop 事件循环
+ * @param slack 允许推迟的秒数，0表示精确唤醒
+ */
+void ev_set_timer_slack(struct ev_loop *loop, ev_tstamp slack) noexcept
+{
+    timer_slack = slack > 0. ? slack : 0.;
+}
+
+#if EV_HRTIMER_ENABLE
+void ev_set_hires_margin(struct ev_loop *loop, ev_tstamp margin) noexcept
+{
+    hires_margin = margin > 0. ? margin : 0.;
+}
+#endif
+
 void ev_set_userdata(struct ev_loop *loop, void *data) noexcept
 {
     userdata = data;
@@ -1729,68 +2711,242 @@ void ev_set_loop_release_cb(struct ev_loop *loop, void (*release)(struct ev_loop
 }
 #endif
 
-/* initialise a loop structure, must be zero-initialised */
-__cold static void loop_init(ev_loop *loop, unsigned flags) noexcept
+/*
+ * 阻塞等待前的忙轮询阶段
+ * @param loop 事件循环实例
+ * @param waittime 计划的阻塞时间，返回时扣除已经忙轮询的时间
+ * @param exact 剩余时间不足backend_mintime时不再阻塞，而不是延长到backend_mintime(高精度定时器)
+ * @return 有事件待处理或计划的等待时间已过时返回1，不再需要阻塞等待
+ *
+ * 以零超时反复调用backend_poll，直到有事件就绪或busy_poll预算用完，
+ * 用一个CPU核心换取更低的唤醒延迟。
+ * 预算总是用get_clock计量：粗粒度时钟下loop_clock要到下一个tick才前进，会多自旋一整个tick，
+ * 而每轮本来就有一次backend_poll系统调用，多读一次精确时钟的开销可以忽略。
+ */
+static int busy_poll_spin(struct ev_loop *loop, ev_tstamp *waittime, int exact)
 {
-    if (!backend) // 判断是否已经初始化
+    ev_timekey start = get_clock();
+    ev_tstamp limit = busy_poll < *waittime ? busy_poll : *waittime;
+    ev_tstamp spun;
+    int pri;
+
+    for (;;)
     {
-        origflags = flags;
+        backend_poll(loop, 0.);
 
-#if EV_USE_REALTIME
-        if (!have_realtime)
-        {
-            struct timespec ts;
+        for (pri = NUMPRI; pri--;)
+            if (pendingcnt[pri])
+                return 1;
 
-            if (!clock_gettime(CLOCK_REALTIME, &ts))
-                have_realtime = 1;
-        }
-#endif
+        if (pipe_write_skipped)
+            return 1;
 
-#if EV_USE_MONOTONIC
-        if (!have_monotonic)
-        {
-            struct timespec ts;
+        spun = EV_KEY2TS(get_clock() - start);
 
-            if (!clock_gettime(CLOCK_MONOTONIC, &ts))
-                have_monotonic = 1;
-        }
-#endif
+        if (spun >= limit)
+            break;
+    }
 
-        /* pid check not overridable via env */
-#ifndef _WIN32
-        if (flags & EVFLAG_FORKCHECK)
-            curpid = getpid();
-#endif
+    if (spun >= *waittime)
+        return 1;
 
-        if (!(flags & EVFLAG_NOENV) && !enable_secure() && getenv("LIBEV_FLAGS"))
-            flags = atoi(getenv("LIBEV_FLAGS"));
+    *waittime -= spun;
 
-        ev_rt_now = ev_time();
-        mn_now = get_clock();
-        now_floor = mn_now;
-        rtmn_diff = ev_rt_now - mn_now;
-#if EV_FEATURE_API
-        invoke_cb = ev_invoke_pending;
-#endif
+    if (*waittime < backend_mintime)
+    {
+        if (exact)
+            return 1;
 
-        io_blocktime = 0.;
-        timeout_blocktime = 0.;
-        backend = 0;
-        backend_fd = -1;
-        sig_pending = 0;
-#if EV_ASYNC_ENABLE
-        async_pending = 0;
-#endif
-        pipe_write_skipped = 0;
-        pipe_write_wanted = 0;
-        evpipe[0] = -1;
-        evpipe[1] = -1;
-#if EV_USE_INOTIFY
-        fs_fd = flags & EVFLAG_NOINOTIFY ? -1 : -2;
-#endif
-#if EV_USE_SIGNALFD
-        sigfd = flags & EVFLAG_SIGNALFD ? -2 : -1;
-#endif
+        *waittime = backend_mintime;
+    }
+
+    return 0;
+}
+
+#if EV_USE_TIMERFD
+/* timerfd只负责唤醒，读出到期次数以清除可读状态，到期的定时器由timers_reify处理 */
+static void timerfdcb(struct ev_loop *loop, ev_io *iow, int revents)
+{
+    uint64_t expirations;
+
+    read(timerfd, &expirations, sizeof(expirations));
+
+    /* 已经到期解除，即使堆顶不变下次也要重新设置 */
+    timerfd_at = 0.;
+}
+
+/*
+ * 创建循环自己的timerfd并以内部I/O观察者监听
+ * @param loop 事件循环实例
+ *
+ * 失败时timerfd为-1，ev_run退回按相对等待时间阻塞。
+ */
+static void timerfd_init(struct ev_loop *loop)
+{
+    timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (timerfd >= 0)
+    {
+        fd_intern(timerfd); /* doing it twice will not hurt */
+
+        timerfd_at = 0.;
+
+        ev_io_init(&timerfd_w, timerfdcb, timerfd, EV_READ);
+        ev_set_priority(&timerfd_w, EV_MAXPRI);
+        ev_io_start(loop, &timerfd_w);
+        ev_unref(loop); /* timerfd watcher should not keep loop alive */
+    }
+}
+
+/*
+ * 把timerfd设置为最早的定时器或周期定时器的绝对到期时刻
+ * @param loop 事件循环实例
+ *
+ * 到期时刻直接取自堆顶，周期定时器按当前的rtmn_diff换算到单调时钟，
+ * 不受回调耗时和毫秒取整的影响。与已设置的时刻相同时不做系统调用。
+ * mn_now由TSC外推或读自粗粒度时钟时可能比内核的CLOCK_MONOTONIC落后约1毫秒，
+ * 直接使用会提前唤醒，timers_reify看不到到期又设置同一时刻，形成空转，
+ * 这时按距mn_now的相对时间换算到get_clock。
+ */
+static void timerfd_arm(struct ev_loop *loop)
+{
+    ev_timekey at = 0; /* 0表示解除 */
+    struct itimerspec its;
+
+    if (timercnt)
+        at = timers_next_at(loop);
+
+#if EV_PERIODIC_ENABLE
+    if (periodiccnt)
+    {
+        ev_timekey pat = ANHE_at(periodics[HEAP0]) - EV_TS2KEY(ev_rt_now) + mn_now;
+
+        if (!timercnt || pat < at)
+            at = pat;
+    }
+#endif
+
+    if (at)
+    {
+        at += EV_TS2KEY(timer_slack);
+
+        /* don't let timeouts decrease the waittime below timeout_blocktime */
+        if (at < mn_now + EV_TS2KEY(timeout_blocktime))
+            at = mn_now + EV_TS2KEY(timeout_blocktime);
+
+        /* 全零会解除定时器，已经过期的时刻用最小的非零值代替 */
+        if (at <= 0)
+            at = EV_TS2KEY(1e-6);
+    }
+
+    if (expect_true(at == timerfd_at))
+        return;
+
+    timerfd_at = at;
+
+#if EV_USE_TSC
+    if (tsc_scale && at)
+        at += get_clock() - mn_now;
+#endif
+#if EV_USE_COARSE_CLOCK
+    if (clock_coarse && at)
+        at += get_clock() - mn_now;
+#endif
+
+    its.it_interval.tv_sec = 0;
+    its.it_interval.tv_nsec = 0;
+    EV_TS_SET(its.it_value, EV_KEY2TS(at));
+
+    timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &its, 0);
+}
+#endif
+
+/* initialise a loop structure, must be zero-initialised */
+__cold static void loop_init(ev_loop *loop, unsigned flags) noexcept
+{
+    if (!backend) // 判断是否已经初始化
+    {
+        origflags = flags;
+
+#if EV_USE_REALTIME
+        if (!have_realtime)
+        {
+            struct timespec ts;
+
+            if (!clock_gettime(CLOCK_REALTIME, &ts))
+                have_realtime = 1;
+        }
+#endif
+
+#if EV_USE_MONOTONIC
+        if (!have_monotonic)
+        {
+            struct timespec ts;
+
+            if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+                have_monotonic = 1;
+        }
+#endif
+
+        /* pid check not overridable via env */
+#ifndef _WIN32
+        if (flags & EVFLAG_FORKCHECK)
+            curpid = getpid();
+#endif
+
+        if (!(flags & EVFLAG_NOENV) && !enable_secure() && getenv("LIBEV_FLAGS"))
+            flags = atoi(getenv("LIBEV_FLAGS"));
+
+#if EV_USE_COARSE_CLOCK
+        coarse_init(loop, flags);
+
+        /* 粗粒度时钟不需要timerfd的精度 */
+        if (clock_coarse)
+            flags &= ~EVFLAG_TIMERFD;
+#endif
+
+#if EV_USE_TSC
+        tsc_init(loop, flags);
+#endif
+
+        ev_rt_now = loop_time(loop);
+        mn_now = loop_clock(loop);
+        now_floor = mn_now;
+#if EV_USE_TIMERWHEEL
+        timerwheel_tick = timerwheel_tickof(mn_now);
+#endif
+        rtmn_diff = ev_rt_now - EV_KEY2TS(mn_now);
+#if EV_FEATURE_API
+        invoke_cb = ev_invoke_pending;
+#endif
+
+        io_blocktime = 0.;
+        timeout_blocktime = 0.;
+        timer_slack = 0.;
+#if EV_HRTIMER_ENABLE
+        hires_margin = EV_HIRES_MARGIN;
+#endif
+        backend = 0;
+        backend_fd = -1;
+        backend_modify_batch = 0;
+        sig_pending = 0;
+#if EV_ASYNC_ENABLE
+        async_pending = 0;
+        feedmt_pending = 0;
+#endif
+        pipe_write_skipped = 0;
+        pipe_write_wanted = 0;
+        evpipe[0] = -1;
+        evpipe[1] = -1;
+#if EV_USE_INOTIFY
+        fs_fd = flags & EVFLAG_NOINOTIFY ? -1 : -2;
+#endif
+#if EV_USE_SIGNALFD
+        sigfd = flags & EVFLAG_SIGNALFD ? -2 : -1;
+#endif
+#if EV_USE_TIMERFD
+        timerfd = -1;
+#endif
 
         if (!(flags & EVBACKEND_MASK))
             flags |= ev_recommended_backends();
@@ -1807,6 +2963,14 @@ __cold static void loop_init(ev_loop *loop, unsigned flags) noexcept
         if (!backend && (flags & EVBACKEND_KQUEUE))
             backend = kqueue_init(loop, flags);
 #endif
+#if EV_USE_IOURING
+        if (!backend && (flags & EVBACKEND_IOURING))
+            backend = iouring_init(loop, flags);
+#endif
+#if EV_USE_LINUXAIO
+        if (!backend && (flags & EVBACKEND_LINUXAIO))
+            backend = linuxaio_init(loop, flags);
+#endif
 #if EV_USE_EPOLL
         if (!backend && (flags & EVBACKEND_EPOLL))
             backend = epoll_init(loop, flags);
@@ -1825,6 +2989,23 @@ __cold static void loop_init(ev_loop *loop, unsigned flags) noexcept
         ev_init(&pipe_w, pipecb);
         ev_set_priority(&pipe_w, EV_MAXPRI);
 #endif
+
+#if EV_USE_COARSE_CLOCK
+        /* 时间最多落后一个时钟节拍，等待时间不短于这个节拍，避免在节拍内反复短暂唤醒 */
+        if (clock_coarse)
+        {
+            struct timespec ts;
+
+            if (!clock_getres(CLOCK_MONOTONIC_COARSE, &ts) && backend_mintime < ts.tv_sec + ts.tv_nsec * 1e-9)
+                backend_mintime = ts.tv_sec + ts.tv_nsec * 1e-9;
+        }
+#endif
+
+#if EV_USE_TIMERFD
+        /* 绝对时刻只能以单调时钟表达，没有单调时钟时退回相对等待 */
+        if (backend && (flags & EVFLAG_TIMERFD) && have_monotonic)
+            timerfd_init(loop);
+#endif
     }
 }
 
@@ -1872,6 +3053,11 @@ void __cold ev_loop_destroy(struct ev_loop *loop)
         close(sigfd);
 #endif
 
+#if EV_USE_TIMERFD
+    if (timerfd >= 0)
+        close(timerfd);
+#endif
+
 #if EV_USE_INOTIFY
     if (fs_fd >= 0)
         close(fs_fd);
@@ -1892,6 +3078,14 @@ void __cold ev_loop_destroy(struct ev_loop *loop)
     if (backend == EVBACKEND_KQUEUE)
         kqueue_destroy(loop);
 #endif
+#if EV_USE_IOURING
+    if (backend == EVBACKEND_IOURING)
+        iouring_destroy(loop);
+#endif
+#if EV_USE_LINUXAIO
+    if (backend == EVBACKEND_LINUXAIO)
+        linuxaio_destroy(loop);
+#endif
 #if EV_USE_EPOLL
     if (backend == EVBACKEND_EPOLL)
         epoll_destroy(loop);
@@ -1913,27 +3107,48 @@ void __cold ev_loop_destroy(struct ev_loop *loop)
 #endif
     }
 
-    ev_free(anfds);
-    anfds = 0;
-    anfdmax = 0;
+    anfds_free(loop);
 
     /* have to use the microsoft-never-gets-it-right macro */
     array_free(rfeed, EMPTY);
     array_free(fdchange, EMPTY);
+    array_free(fdmod, EMPTY);
     array_free(timer, EMPTY);
+#if EV_USE_LAZYTIMERS
+    timerdead = 0;
+#endif
+#if EV_USE_TIMERWHEEL
+    ev_free(timerlinks);
+    timerlinks = 0;
+    timerlinkmax = 0;
+    ev_free(timerwheel_work);
+    timerwheel_work = 0;
+    timerwheel_workmax = 0;
+#endif
+#if EV_HRTIMER_ENABLE
+    array_free(hrtimer, EMPTY);
+#endif
 #if EV_PERIODIC_ENABLE
     array_free(periodic, EMPTY);
+    periodicstale = 0;
 #endif
 #if EV_FORK_ENABLE
     array_free(fork, EMPTY);
 #endif
 #if EV_CLEANUP_ENABLE
     array_free(cleanup, EMPTY);
+#endif
+#if EV_DEADLINE_ENABLE
+    while (deadlinegroupcnt)
+        ev_free(deadlinegroups[--deadlinegroupcnt]);
+    array_free(deadlinegroup, EMPTY);
 #endif
     array_free(prepare, EMPTY);
     array_free(check, EMPTY);
 #if EV_ASYNC_ENABLE
     array_free(async, EMPTY);
+    ev_free(feedmt);
+    feedmt = 0;
 #endif
 
     backend = 0;
@@ -1962,6 +3177,14 @@ static inline void loop_fork(struct ev_loop *loop)
     if (backend == EVBACKEND_KQUEUE)
         kqueue_fork(loop);
 #endif
+#if EV_USE_IOURING
+    if (backend == EVBACKEND_IOURING)
+        iouring_fork(loop);
+#endif
+#if EV_USE_LINUXAIO
+    if (backend == EVBACKEND_LINUXAIO)
+        linuxaio_fork(loop);
+#endif
 #if EV_USE_EPOLL
     if (backend == EVBACKEND_EPOLL)
         epoll_fork(loop);
@@ -1970,6 +3193,17 @@ static inline void loop_fork(struct ev_loop *loop)
     infy_fork(loop);
 #endif
 
+#if EV_USE_TIMERFD
+    /* timerfd与父进程共享同一个定时器，必须重新创建 */
+    if (timerfd >= 0)
+    {
+        ev_ref(loop);
+        ev_io_stop(loop, &timerfd_w);
+        close(timerfd);
+        timerfd_init(loop);
+    }
+#endif
+
 #if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE
     if (ev_is_active(&pipe_w) && postfork != 2)
     {
@@ -2024,14 +3258,45 @@ static void noinline __cold verify_heap(struct ev_loop *loop, ANHE *heap, int N)
 
     for (i = HEAP0; i < N + HEAP0; ++i)
     {
-        assert(("libev: active index mismatch in heap", ev_active(ANHE_w(heap[i])) == i));
         assert(("libev: heap condition violated", i == HEAP0 || ANHE_at(heap[HPARENT(i)]) <= ANHE_at(heap[i])));
+
+#if EV_USE_LAZYTIMERS
+        /* 墓碑只需满足堆序 */
+        if (ANHE_w(heap[i]) == (WT)&timertomb)
+            continue;
+#endif
+
+        assert(("libev: active index mismatch in heap", ev_active(ANHE_w(heap[i])) == i));
         assert(("libev: heap at cache mismatch", ANHE_at(heap[i]) == ev_at(ANHE_w(heap[i]))));
 
         verify_watcher(loop, (W)ANHE_w(heap[i]));
     }
 }
 
+#if EV_USE_TIMERWHEEL
+static void noinline __cold verify_timerwheel(struct ev_loop *loop)
+{
+    int i;
+
+    for (i = HEAP0; i < timercnt + HEAP0; ++i)
+    {
+        ANTW *l = timerlinks + i;
+
+        assert(("libev: active index mismatch in timer wheel", ev_active(ANHE_w(timers[i])) == i));
+        assert(("libev: timer wheel at cache mismatch", ANHE_at(timers[i]) == ev_at(ANHE_w(timers[i]))));
+
+        /* 正在timers_reify中处理的定时器暂时不在任何槽中 */
+        if (l->slot >= 0)
+        {
+            assert(("libev: timer wheel list corrupted", l->prev ? timerlinks[l->prev].next == i : timerwheel[l->slot] == i));
+            assert(("libev: timer wheel list corrupted", !l->next || timerlinks[l->next].prev == i));
+        }
+
+        verify_watcher(loop, (W)ANHE_w(timers[i]));
+    }
+}
+#endif
+
 static void noinline __cold array_verify(struct ev_loop *loop, W *ws, int cnt)
 {
     while (cnt--)
@@ -2077,11 +3342,33 @@ void __cold ev_verify(struct ev_loop *loop) noexcept
     }
 
     assert(timermax >= timercnt);
+#if EV_USE_TIMERWHEEL
+    verify_timerwheel(loop);
+#else
     verify_heap(loop, timers, timercnt);
+#endif
+#if EV_USE_LAZYTIMERS
+    {
+        int dead = 0;
+
+        for (i = HEAP0; i < timercnt + HEAP0; ++i)
+            dead += ANHE_w(timers[i]) == (WT)&timertomb;
+
+        assert(("libev: timer tombstone count mismatch", dead == timerdead));
+    }
+#endif
+
+#if EV_HRTIMER_ENABLE
+    assert(hrtimermax >= hrtimercnt);
+    verify_heap(loop, hrtimers, hrtimercnt);
+#endif
 
 #if EV_PERIODIC_ENABLE
-    assert(periodicmax >= periodiccnt);
+    assert(periodicmax >= periodiccnt + periodicstale);
     verify_heap(loop, periodics, periodiccnt);
+
+    for (i = periodiccnt + HEAP0; i < periodiccnt + periodicstale + HEAP0; ++i)
+        assert(("libev: stale periodic index mismatch", ev_active(ANHE_w(periodics[i])) == i));
 #endif
 
     for (i = NUMPRI; i--;)
@@ -2104,6 +3391,25 @@ void __cold ev_verify(struct ev_loop *loop) noexcept
     array_verify(loop, (W *)cleanups, cleanupcnt);
 #endif
 
+#if EV_DEADLINE_ENABLE
+    assert(deadlinegroupmax >= deadlinegroupcnt);
+    for (i = 0; i < deadlinegroupcnt; ++i)
+    {
+        ANDL *g = deadlinegroups[i];
+        ev_deadline *d;
+
+        assert(("libev: deadline group index mismatch", g->index == i));
+        assert(("libev: empty deadline group", g->head));
+
+        for (d = g->head; d; d = d->next)
+        {
+            assert(("libev: deadline watcher in wrong group", d->group == g && ev_active(d) == 1));
+            assert(("libev: deadline FIFO out of order", !d->next || d->last_activity <= d->next->last_activity));
+            verify_watcher(loop, (W)d);
+        }
+    }
+#endif
+
 #if EV_ASYNC_ENABLE
     assert(asyncmax >= asynccnt);
     array_verify(loop, (W *)asyncs, asynccnt);
@@ -2230,6 +3536,174 @@ static inline void idle_reify(struct ev_loop *loop)
 }
 #endif
 
+#if EV_USE_TIMERWHEEL
+/* 按到期时刻排序同一格中的定时器 */
+static int timerwheel_cmp(const void *a, const void *b)
+{
+    ev_timekey at_a = (*(const WT *)a)->at;
+    ev_timekey at_b = (*(const WT *)b)->at;
+
+    return at_a < at_b ? -1 : at_a > at_b;
+}
+
+/*
+ * 处理第0层的一个槽
+ * @param loop 事件循环实例
+ * @param slot 第0层的槽号
+ * @return 触发的定时器数
+ *
+ * 先把整个槽摘下并按at排序，到期的依次重新调度或停止并加入反向队列，
+ * 未到期的(只可能在当前格)重新挂回时间轮。
+ */
+static int timerwheel_fire(struct ev_loop *loop, int slot)
+{
+    int cnt = 0, fired = 0;
+    int i, k;
+
+    for (i = timerwheel[slot]; i; i = timerlinks[i].next)
+    {
+        array_needsize(WT, timerwheel_work, timerwheel_workmax, cnt + 1, EMPTY2);
+        timerwheel_work[cnt++] = ANHE_w(timers[i]);
+        timerlinks[i].slot = -1;
+    }
+
+    timerwheel[slot] = 0;
+    timerwheel_bits[slot / 64] &= ~((uint64_t)1 << (slot % 64));
+
+    if (cnt > 1)
+        qsort(timerwheel_work, cnt, sizeof(WT), timerwheel_cmp);
+
+    for (k = 0; k < cnt; ++k)
+    {
+        ev_timer *w = (ev_timer *)timerwheel_work[k];
+
+        if (ev_at(w) < mn_now)
+        {
+            /* first reschedule or stop timer */
+            if (w->repeat)
+            {
+                ev_at(w) += EV_TS2KEY(w->repeat);
+                if (ev_at(w) < mn_now)
+                    ev_at(w) = mn_now;
+
+                assert(("libev: negative ev_timer repeat value found while processing timers", w->repeat > 0.));
+
+                ANHE_at_cache(timers[ev_active(w)]);
+                timerwheel_link(loop, ev_active(w));
+            }
+            else
+                ev_timer_stop(loop, w); /* nonrepeating: stop timer */
+
+            EV_FREQUENT_CHECK;
+            feed_reverse(loop, (W)w);
+            ++fired;
+        }
+        else
+            timerwheel_link(loop, ev_active(w));
+    }
+
+    return fired;
+}
+
+/* make timers pending */
+static inline void timers_reify(struct ev_loop *loop)
+{
+    int64_t now = timerwheel_tickof(mn_now);
+    int fired = 0;
+
+    EV_FREQUENT_CHECK;
+
+    /* 没有定时器时直接跟上当前时刻 */
+    if (!timercnt)
+    {
+        if (timerwheel_tick < now)
+            timerwheel_tick = now;
+
+        return;
+    }
+
+    for (;;)
+    {
+        int idx = (int)(timerwheel_tick & EV_TIMERWHEEL_MASK);
+
+        /* 第0层转完一圈，从上一层级联下一段，上一层也转完时继续向上 */
+        if (!idx)
+        {
+            int level;
+
+            for (level = 1; level < EV_TIMERWHEEL_LEVELS && !timerwheel_cascade(loop, level); ++level)
+                ;
+        }
+
+        /* 跳过空槽，最多跳到本圈结束(需要级联)或当前格 */
+        if (timerwheel_tick < now)
+        {
+            int slot = timerwheel_find(loop, 0, idx);
+            int64_t target = slot < EV_TIMERWHEEL_SLOTS ? timerwheel_tick - idx + slot : (timerwheel_tick | EV_TIMERWHEEL_MASK) + 1;
+
+            if (target > now)
+                target = now;
+
+            if (target != timerwheel_tick)
+            {
+                timerwheel_tick = target;
+                continue;
+            }
+        }
+
+        if (timerwheel[idx])
+            fired += timerwheel_fire(loop, idx);
+
+        if (timerwheel_tick >= now)
+            break;
+
+        ++timerwheel_tick;
+    }
+
+    if (fired)
+        feed_reverse_done(loop, EV_TIMER);
+}
+#else
+#if EV_USE_LAZYTIMERS
+/*
+ * 移除堆中所有墓碑并用reheap在O(n)内重建堆
+ * 墓碑超过一半时由ev_timer_stop调用，批量停止的总开销因此是O(n)而不是O(n log n)
+ */
+static void noinline timers_compact(struct ev_loop *loop)
+{
+    int i, j = HEAP0;
+
+    for (i = HEAP0; i < timercnt + HEAP0; ++i)
+        if (ANHE_w(timers[i]) != (WT)&timertomb)
+        {
+            timers[j] = timers[i];
+            ev_active(ANHE_w(timers[j])) = j;
+            ++j;
+        }
+
+    timercnt = j - HEAP0;
+    timerdead = 0;
+
+    reheap(timers, timercnt);
+}
+
+/* 移除堆顶的墓碑，直到堆顶是活动的定时器或堆为空 */
+inline_speed void timers_drop_dead(struct ev_loop *loop)
+{
+    while (timerdead && timercnt && ANHE_w(timers[HEAP0]) == (WT)&timertomb)
+    {
+        --timerdead;
+        --timercnt;
+
+        if (timercnt)
+        {
+            timers[HEAP0] = timers[timercnt + HEAP0];
+            downheap(timers, timercnt, HEAP0);
+        }
+    }
+}
+#endif
+
 /* make timers pending */
 static inline void timers_reify(struct ev_loop *loop)
 {
@@ -2241,12 +3715,20 @@ static inline void timers_reify(struct ev_loop *loop)
         {
             ev_timer *w = (ev_timer *)ANHE_w(timers[HEAP0]);
 
+#if EV_USE_LAZYTIMERS
+            if (expect_false((WT)w == (WT)&timertomb))
+            {
+                timers_drop_dead(loop);
+                continue;
+            }
+#endif
+
             /*assert (("libev: inactive timer on timer heap detected", ev_is_active (w)));*/
 
             /* first reschedule or stop timer */
             if (w->repeat)
             {
-                ev_at(w) += w->repeat;
+                ev_at(w) += EV_TS2KEY(w->repeat);
                 if (ev_at(w) < mn_now)
                     ev_at(w) = mn_now;
 
@@ -2265,38 +3747,127 @@ static inline void timers_reify(struct ev_loop *loop)
         feed_reverse_done(loop, EV_TIMER);
     }
 }
+#endif
+
+#if EV_HRTIMER_ENABLE
+/* make hrtimers pending，与timers_reify相同，只是使用独立的堆 */
+static inline void hrtimers_reify(struct ev_loop *loop)
+{
+    EV_FREQUENT_CHECK;
+
+    if (hrtimercnt && ANHE_at(hrtimers[HEAP0]) < mn_now)
+    {
+        do
+        {
+            ev_hrtimer *w = (ev_hrtimer *)ANHE_w(hrtimers[HEAP0]);
+
+            if (w->repeat)
+            {
+                ev_at(w) += EV_TS2KEY(w->repeat);
+                if (ev_at(w) < mn_now)
+                    ev_at(w) = mn_now;
+
+                assert(("libev: negative ev_hrtimer repeat value found while processing timers", w->repeat > 0.));
+
+                ANHE_at_cache(hrtimers[HEAP0]);
+                downheap(hrtimers, hrtimercnt, HEAP0);
+            }
+            else
+                ev_hrtimer_stop(loop, w); /* nonrepeating: stop timer */
+
+            EV_FREQUENT_CHECK;
+            feed_reverse(loop, (W)w);
+        } while (hrtimercnt && ANHE_at(hrtimers[HEAP0]) < mn_now);
+
+        feed_reverse_done(loop, EV_TIMER);
+    }
+}
+
+/*
+ * 自旋到最早的高精度定时器到期
+ * @param loop 事件循环实例
+ *
+ * 后端因I/O事件提前返回、离到期还超过hires_margin时不自旋，先回到循环处理事件。
+ */
+static void noinline hrtimers_spin(struct ev_loop *loop)
+{
+    ev_timekey at = ANHE_at(hrtimers[HEAP0]);
+    ev_timekey now = loop_clock(loop);
+
+    if (at - now > EV_TS2KEY(hires_margin))
+        return;
+
+    /* timers_reify只处理严格早于mn_now的定时器 */
+    while (now <= at)
+        now = loop_clock(loop);
+}
+#endif
 
 #if EV_PERIODIC_ENABLE
 
-static void noinline periodic_recalc(struct ev_loop *loop, ev_periodic *w)
+/* 以now为准重新计算间隔周期定时器的下一个到期时刻 */
+static void noinline periodic_recalc(struct ev_loop *loop, ev_periodic *w, ev_tstamp now)
 {
     ev_tstamp interval = w->interval > MIN_INTERVAL ? w->interval : MIN_INTERVAL;
-    ev_tstamp at = w->offset + interval * ev_floor((ev_rt_now - w->offset) / interval);
+    ev_tstamp at = w->offset + interval * ev_floor((now - w->offset) / interval);
 
     /* the above almost always errs on the low side */
-    while (at <= ev_rt_now)
+    while (at <= now)
     {
         ev_tstamp nat = at + w->interval;
 
-        /* when resolution fails us, we use ev_rt_now */
+        /* when resolution fails us, we use now */
         if (nat == at) [[unlikely]]
         {
-            at = ev_rt_now;
+            at = now;
             break;
         }
 
         at = nat;
     }
 
-    ev_at(w) = at;
+    ev_at(w) = EV_TS2KEY(at);
+}
+
+/*
+ * 把堆之后的一批周期定时器按periodicjump重新计算并插回堆中
+ * @param loop 事件循环实例
+ *
+ * 间隔周期定时器的到期时刻在offset + k * interval的网格上，时间跳变后只要它仍是
+ * periodicjump之后的第一个网格点就不需要重新计算。插入按数组顺序进行，
+ * 条目原本就是堆序，到期时刻没有变化的条目upheap通常一步也不用移动。
+ */
+static void noinline periodics_migrate(struct ev_loop *loop)
+{
+    int n = periodicstale < EV_PERIODIC_CHUNK ? periodicstale : EV_PERIODIC_CHUNK;
+    ev_timekey jump = EV_TS2KEY(periodicjump);
+
+    while (n--)
+    {
+        int i = periodiccnt + HEAP0;
+        ev_periodic *w = (ev_periodic *)ANHE_w(periodics[i]);
+
+        if (w->reschedule_cb)
+            ev_at(w) = EV_TS2KEY(w->reschedule_cb(w, periodicjump));
+        else if (w->interval && (ev_at(w) <= jump || ev_at(w) - EV_TS2KEY(w->interval) > jump))
+            periodic_recalc(loop, w, periodicjump);
+
+        ANHE_at_cache(periodics[i]);
+        ++periodiccnt;
+        --periodicstale;
+        upheap(periodics, i);
+    }
 }
 
 /* make periodics pending */
 static inline void periodics_reify(struct ev_loop *loop)
 {
+    if (periodicstale) [[unlikely]]
+        periodics_migrate(loop);
+
     EV_FREQUENT_CHECK;
 
-    while (periodiccnt && ANHE_at(periodics[HEAP0]) < ev_rt_now)
+    while (periodiccnt && ANHE_at(periodics[HEAP0]) < EV_TS2KEY(ev_rt_now))
     {
         do
         {
@@ -2306,16 +3877,16 @@ static inline void periodics_reify(struct ev_loop *loop)
             /* first reschedule or stop timer */
             if (w->reschedule_cb)
             {
-                ev_at(w) = w->reschedule_cb(w, ev_rt_now);
+                ev_at(w) = EV_TS2KEY(w->reschedule_cb(w, ev_rt_now));
 
-                assert(("libev: ev_periodic reschedule callback returned time in the past", ev_at(w) >= ev_rt_now));
+                assert(("libev: ev_periodic reschedule callback returned time in the past", ev_at(w) >= EV_TS2KEY(ev_rt_now)));
 
                 ANHE_at_cache(periodics[HEAP0]);
                 downheap(periodics, periodiccnt, HEAP0);
             }
             else if (w->interval)
             {
-                periodic_recalc(loop, w);
+                periodic_recalc(loop, w, ev_rt_now);
                 ANHE_at_cache(periodics[HEAP0]);
                 downheap(periodics, periodiccnt, HEAP0);
             }
@@ -2324,46 +3895,76 @@ static inline void periodics_reify(struct ev_loop *loop)
 
             EV_FREQUENT_CHECK;
             feed_reverse(loop, (W)w);
-        } while (periodiccnt && ANHE_at(periodics[HEAP0]) < ev_rt_now);
+        } while (periodiccnt && ANHE_at(periodics[HEAP0]) < EV_TS2KEY(ev_rt_now));
 
         feed_reverse_done(loop, EV_PERIODIC);
     }
 }
 
-/* simply recalculate all periodics */
+/*
+ * 时间跳变后重新安排所有周期定时器
+ * @param loop 事件循环实例
+ *
+ * 不在这里一次性重新计算并重建整个堆，只把堆整体移到periodicstale，由periodics_reify
+ * 每次迭代处理EV_PERIODIC_CHUNK个，处理完之前ev_run不阻塞。间隔周期定时器不能简单地
+ * 整体平移，那样会离开offset + k * interval的网格。
+ */
 /* TODO: maybe ensure that at least one event happens when jumping forward? */
 static void noinline __cold periodics_reschedule(struct ev_loop *loop)
 {
-    int i;
-
-    /* adjust periodics after time jump */
-    for (i = HEAP0; i < periodiccnt + HEAP0; ++i)
-    {
-        ev_periodic *w = (ev_periodic *)ANHE_w(periodics[i]);
-
-        if (w->reschedule_cb)
-            ev_at(w) = w->reschedule_cb(w, ev_rt_now);
-        else if (w->interval)
-            periodic_recalc(loop, w);
-
-        ANHE_at_cache(periodics[i]);
-    }
-
-    reheap(periodics, periodiccnt);
+    /* 上一次跳变还没有处理完时，已经插回堆中的条目也要按新的时间重新检查 */
+    periodicstale += periodiccnt;
+    periodiccnt = 0;
+    periodicjump = ev_rt_now;
 }
 #endif
 
 /* adjust all timers by a given offset */
-static void noinline __cold timers_reschedule(struct ev_loop *loop, ev_tstamp adjust)
+static void noinline __cold timers_reschedule(struct ev_loop *loop, ev_timekey adjust)
 {
     int i;
 
     for (i = 0; i < timercnt; ++i)
     {
         ANHE *he = timers + i + HEAP0;
+
+#if EV_USE_LAZYTIMERS
+        if (ANHE_w(*he) == (WT)&timertomb)
+        {
+            ANHE_at(*he) += adjust;
+            continue;
+        }
+#endif
+
         ANHE_w(*he)->at += adjust;
         ANHE_at_cache(*he);
     }
+
+#if EV_USE_TIMERWHEEL
+    /* 以调整前后较早的时刻为当前格重建，之后不会漏掉任何已过期的定时器 */
+    timerwheel_rebuild(loop, timerwheel_tickof(adjust < 0 ? mn_now + adjust : mn_now));
+#endif
+
+#if EV_HRTIMER_ENABLE
+    for (i = 0; i < hrtimercnt; ++i)
+    {
+        ANHE *he = hrtimers + i + HEAP0;
+
+        ANHE_w(*he)->at += adjust;
+        ANHE_at_cache(*he);
+    }
+#endif
+
+#if EV_DEADLINE_ENABLE
+    /* 组定时器已随上面一起调整，最后活动时间也要同样平移 */
+    for (i = 0; i < deadlinegroupcnt; ++i)
+    {
+        ev_deadline *d;
+
+        for (d = deadlinegroups[i]->head; d; d = d->next)
+            d->last_activity += adjust;
+    }
+#endif
 }
 
 /* fetch new monotonic and realtime times from the kernel */
@@ -2376,18 +3977,18 @@ static inline void time_update(struct ev_loop *loop, ev_tstamp max_block)
         int i;
         ev_tstamp odiff = rtmn_diff;
 
-        mn_now = get_clock();
+        mn_now = loop_clock(loop);
 
         /* only fetch the realtime clock every 0.5*MIN_TIMEJUMP seconds */
         /* interpolate in the meantime */
-        if (expect_true(mn_now - now_floor < MIN_TIMEJUMP * .5))
+        if (expect_true(mn_now - now_floor < EV_TS2KEY(MIN_TIMEJUMP * .5)))
         {
-            ev_rt_now = rtmn_diff + mn_now;
+            ev_rt_now = rtmn_diff + EV_KEY2TS(mn_now);
             return;
         }
 
         now_floor = mn_now;
-        ev_rt_now = ev_time();
+        ev_rt_now = loop_time(loop);
 
         /* loop a few times, before making important decisions.
          * on the choice of "4": one iteration isn't enough,
@@ -2400,15 +4001,15 @@ static inline void time_update(struct ev_loop *loop, ev_tstamp max_block)
         for (i = 4; --i;)
         {
             ev_tstamp diff;
-            rtmn_diff = ev_rt_now - mn_now;
+            rtmn_diff = ev_rt_now - EV_KEY2TS(mn_now);
 
             diff = odiff - rtmn_diff;
 
             if (expect_true((diff < 0. ? -diff : diff) < MIN_TIMEJUMP))
                 return; /* all is well */
 
-            ev_rt_now = ev_time();
-            mn_now = get_clock();
+            ev_rt_now = loop_time(loop);
+            mn_now = loop_clock(loop);
             now_floor = mn_now;
         }
 
@@ -2421,21 +4022,42 @@ static inline void time_update(struct ev_loop *loop, ev_tstamp max_block)
     else
 #endif
     {
-        ev_rt_now = ev_time();
+        ev_rt_now = loop_time(loop);
 
-        if (mn_now > ev_rt_now || ev_rt_now > mn_now + max_block + MIN_TIMEJUMP) [[unlikely]]
+        if (EV_KEY2TS(mn_now) > ev_rt_now || ev_rt_now > EV_KEY2TS(mn_now) + max_block + MIN_TIMEJUMP) [[unlikely]]
         {
             /* adjust timers. this is easy, as the offset is the same for all of them */
-            timers_reschedule(loop, ev_rt_now - mn_now);
+            timers_reschedule(loop, EV_TS2KEY(ev_rt_now) - mn_now);
 #if EV_PERIODIC_ENABLE
             periodics_reschedule(loop);
 #endif
         }
 
-        mn_now = ev_rt_now;
+        mn_now = EV_TS2KEY(ev_rt_now);
     }
 }
 
+#if EV_USE_COARSE_CLOCK
+/* 按上次更新的时间是否已有定时器或周期定时器到期 */
+static inline int timers_due(struct ev_loop *loop)
+{
+    if (timercnt && timers_next_at(loop) <= mn_now)
+        return 1;
+
+#if EV_HRTIMER_ENABLE
+    if (hrtimercnt && ANHE_at(hrtimers[HEAP0]) <= mn_now)
+        return 1;
+#endif
+
+#if EV_PERIODIC_ENABLE
+    if (periodiccnt && ANHE_at(periodics[HEAP0]) <= EV_TS2KEY(ev_rt_now))
+        return 1;
+#endif
+
+    return 0;
+}
+#endif
+
 int ev_run(struct ev_loop *loop, int flags)
 {
 #if EV_FEATURE_API
@@ -2496,9 +4118,12 @@ int ev_run(struct ev_loop *loop, int flags)
         {
             ev_tstamp waittime = 0.;
             ev_tstamp sleeptime = 0.;
+#if EV_HRTIMER_ENABLE
+            int hrspin = 0; /* 阻塞到最早的高精度定时器的余量开始处，之后自旋 */
+#endif
 
             /* remember old timestamp for io_blocktime calculation */
-            ev_tstamp prev_mn_now = mn_now;
+            ev_timekey prev_mn_now = mn_now;
 
             /* update time to cancel out callback processing overhead */
             time_update(loop, 1e100);
@@ -2508,13 +4133,22 @@ int ev_run(struct ev_loop *loop, int flags)
 
             ECB_MEMORY_FENCE; /* make sure pipe_write_wanted is visible before we check for potential skips */
 
-            if (expect_true(!(flags & EVRUN_NOWAIT || idleall || !activecnt || pipe_write_skipped)))
+            if (expect_true(!(flags & EVRUN_NOWAIT || idleall || !activecnt || pipe_write_skipped
+#if EV_PERIODIC_ENABLE
+                              || periodicstale /* 时间跳变后的周期定时器还没有处理完 */
+#endif
+                              )))
             {
                 waittime = MAX_BLOCKTIME;
 
+#if EV_USE_LAZYTIMERS
+                /* 堆顶的墓碑会让等待时间提前结束 */
+                timers_drop_dead(loop);
+#endif
+
                 if (timercnt)
                 {
-                    ev_tstamp to = ANHE_at(timers[HEAP0]) - mn_now;
+                    ev_tstamp to = EV_KEY2TS(timers_next_at(loop) - mn_now) + timer_slack;
                     if (waittime > to)
                         waittime = to;
                 }
@@ -2522,7 +4156,7 @@ int ev_run(struct ev_loop *loop, int flags)
 #if EV_PERIODIC_ENABLE
                 if (periodiccnt)
                 {
-                    ev_tstamp to = ANHE_at(periodics[HEAP0]) - ev_rt_now;
+                    ev_tstamp to = EV_KEY2TS(ANHE_at(periodics[HEAP0])) + timer_slack - ev_rt_now;
                     if (waittime > to)
                         waittime = to;
                 }
@@ -2532,6 +4166,31 @@ int ev_run(struct ev_loop *loop, int flags)
                 if (expect_false(waittime < timeout_blocktime))
                     waittime = timeout_blocktime;
 
+#if EV_HRTIMER_ENABLE
+                /* 高精度定时器不受timeout_blocktime和backend_mintime的限制，放不下一次最短阻塞时不阻塞 */
+                if (hrtimercnt)
+                {
+                    ev_tstamp to = EV_KEY2TS(ANHE_at(hrtimers[HEAP0]) - mn_now);
+
+#if EV_USE_COARSE_CLOCK
+                    /* 粗粒度时钟下自旋只会空等到下一个tick，只阻塞到到期时刻，与普通定时器相同 */
+                    if (clock_coarse)
+                    {
+                        if (waittime > to)
+                            waittime = to;
+                    }
+                    else
+#endif
+                    if (waittime > to - hires_margin)
+                    {
+                        to -= hires_margin;
+                        waittime = to >= backend_mintime ? to : 0.;
+                        hrspin = 1;
+                    }
+                }
+
+                if (!hrspin)
+#endif
                 /* at this point, we NEED to wait, so we have to ensure */
                 /* to pass a minimum nonzero value to the backend */
                 if (expect_false(waittime < backend_mintime))
@@ -2540,7 +4199,7 @@ int ev_run(struct ev_loop *loop, int flags)
                 /* extra check because io_blocktime is commonly 0 */
                 if (expect_false(io_blocktime))
                 {
-                    sleeptime = io_blocktime - (mn_now - prev_mn_now);
+                    sleeptime = io_blocktime - EV_KEY2TS(mn_now - prev_mn_now);
 
                     if (sleeptime > waittime - backend_mintime)
                         sleeptime = waittime - backend_mintime;
@@ -2557,7 +4216,27 @@ int ev_run(struct ev_loop *loop, int flags)
             ++loop_count;
 #endif
             assert((loop_done = EVBREAK_RECURSE, 1)); /* assert for side effect */
-            backend_poll(loop, waittime);
+#if EV_HRTIMER_ENABLE
+            if (expect_true(!busy_poll) || waittime <= 0. || !busy_poll_spin(loop, &waittime, hrspin))
+#else
+            if (expect_true(!busy_poll) || waittime <= 0. || !busy_poll_spin(loop, &waittime, 0))
+#endif
+            {
+#if EV_USE_TIMERFD
+                /* 由timerfd在绝对时刻唤醒，后端只需等待最长阻塞时间 */
+                if (timerfd >= 0 && waittime > 0.
+#if EV_HRTIMER_ENABLE
+                    && !hrspin
+#endif
+                    )
+                {
+                    timerfd_arm(loop);
+                    backend_poll(loop, MAX_BLOCKTIME);
+                }
+                else
+#endif
+                    backend_poll(loop, waittime);
+            }
             assert((loop_done = EVBREAK_CANCEL, 1)); /* assert for side effect */
 
             pipe_write_wanted = 0; /* just an optimisation, no fence needed */
@@ -2569,12 +4248,24 @@ int ev_run(struct ev_loop *loop, int flags)
                 ev_feed_event(loop, &pipe_w, EV_CUSTOM);
             }
 
+#if EV_HRTIMER_ENABLE
+            if (hrspin)
+                hrtimers_spin(loop);
+#endif
+
             /* update ev_rt_now, do magic */
-            time_update(loop, waittime + sleeptime);
+#if EV_USE_COARSE_CLOCK
+            /* 非阻塞轮询前刚更新过时间，粗粒度时钟在这期间几乎不会前进，没有定时器到期时不再读取 */
+            if (!clock_coarse || waittime > 0. || timers_due(loop))
+#endif
+                time_update(loop, waittime + sleeptime);
         }
 
         /* queue pending timers and reschedule them */
         timers_reify(loop); /* relative timers called last */
+#if EV_HRTIMER_ENABLE
+        hrtimers_reify(loop);
+#endif
 #if EV_PERIODIC_ENABLE
         periodics_reify(loop); /* absolute timers called first */
 #endif
@@ -2624,6 +4315,11 @@ void ev_now_update(struct ev_loop *loop) noexcept
     time_update(loop, 1e100);
 }
 
+ev_tstamp_ns ev_mono_now_ns(struct ev_loop *loop) noexcept
+{
+    return EV_KEY2NS(mn_now);
+}
+
 void ev_suspend(struct ev_loop *loop) noexcept
 {
     ev_now_update(loop);
@@ -2631,7 +4327,7 @@ void ev_suspend(struct ev_loop *loop) noexcept
 
 void ev_resume(struct ev_loop *loop) noexcept
 {
-    ev_tstamp mn_prev = mn_now;
+    ev_timekey mn_prev = mn_now;
 
     ev_now_update(loop);
     timers_reschedule(loop, mn_now - mn_prev);
@@ -2721,12 +4417,13 @@ void noinline ev_io_start(struct ev_loop *loop, ev_io *w) noexcept
         return;
 
     assert(("libev: ev_io_start called with negative fd", fd >= 0));
-    assert(("libev: ev_io_start called with illegal event mask", !(w->events & ~(EV__IOFDSET | EV_READ | EV_WRITE))));
+    assert(("libev: ev_io_start called with illegal event mask", !(w->events & ~(EV__IOFDSET | EV__IOMODES | EV_READ | EV_WRITE))));
 
     EV_FREQUENT_CHECK;
 
     ev_start(loop, (W)w, 1);
-    array_needsize(ANFD, anfds, anfdmax, fd + 1, array_init_zero);
+    if (expect_false(fd >= anfdmax || anfds.pages[(unsigned)fd / EV_ANFD_PAGESIZE] == anfd_zero_page))
+        anfds_needsize(loop, fd);
     wlist_add(&anfds[fd].head, (WL)w);
 
     /* common bug, apparently */
@@ -2772,14 +4469,180 @@ void noinline ev_timer_start(struct ev_loop *loop, ev_timer *w) noexcept
     array_needsize(ANHE, timers, timermax, ev_active(w) + 1, EMPTY2);
     ANHE_w(timers[ev_active(w)]) = (WT)w;
     ANHE_at_cache(timers[ev_active(w)]);
+#if EV_USE_TIMERWHEEL
+    array_needsize(ANTW, timerlinks, timerlinkmax, ev_active(w) + 1, EMPTY2);
+    timerwheel_link(loop, ev_active(w));
+#else
     upheap(timers, ev_active(w));
+#endif
 
     EV_FREQUENT_CHECK;
 
     /*assert (("libev: internal timer heap corruption", timers [ev_active (w)] == (WT)w));*/
 }
 
-void noinline ev_timer_stop(struct ev_loop *loop, ev_timer *w) noexcept
+/*
+ * 批量启动定时器
+ * 先一次性扩容并把所有定时器追加到堆数组末尾，新增的数量不少于已有的数量时
+ * 用reheap在O(n)内重建整个堆，否则逐个upheap。已激活的定时器被忽略
+ * @param loop 事件循环
+ * @param ws 定时器指针数组
+ * @param n 数组长度
+ */
+void noinline ev_timer_start_many(struct ev_loop *loop, ev_timer **ws, int n) noexcept
+{
+    int old = timercnt;
+    int i;
+
+    EV_FREQUENT_CHECK;
+
+    array_needsize(ANHE, timers, timermax, timercnt + n + HEAP0, EMPTY2);
+#if EV_USE_TIMERWHEEL
+    array_needsize(ANTW, timerlinks, timerlinkmax, timercnt + n + HEAP0, EMPTY2);
+#endif
+
+    for (i = 0; i < n; ++i)
+    {
+        ev_timer *w = ws[i];
+
+        if (expect_false(ev_is_active(w)))
+            continue;
+
+        ev_at(w) += mn_now;
+
+        assert(("libev: ev_timer_start_many called with negative timer repeat value", w->repeat >= 0.));
+
+        ++timercnt;
+        ev_start(loop, (W)w, timercnt + HEAP0 - 1);
+        ANHE_w(timers[ev_active(w)]) = (WT)w;
+        ANHE_at_cache(timers[ev_active(w)]);
+#if EV_USE_TIMERWHEEL
+        timerwheel_link(loop, ev_active(w));
+#endif
+    }
+
+#if !EV_USE_TIMERWHEEL
+    if (timercnt - old >= old)
+        reheap(timers, timercnt);
+    else
+        for (i = old; i < timercnt; ++i)
+            upheap(timers, i + HEAP0);
+#endif
+
+    EV_FREQUENT_CHECK;
+}
+
+void noinline ev_timer_stop(struct ev_loop *loop, ev_timer *w) noexcept
+{
+    clear_pending(loop, (W)w);
+    if (expect_false(!ev_is_active(w)))
+        return;
+
+    EV_FREQUENT_CHECK;
+
+    {
+        int active = ev_active(w);
+
+        assert(("libev: internal timer heap corruption", ANHE_w(timers[active]) == (WT)w));
+
+        --timercnt;
+
+#if EV_USE_TIMERWHEEL
+        timerwheel_unlink(loop, active);
+
+        if (expect_true(active < timercnt + HEAP0))
+            timerwheel_move(loop, timercnt + HEAP0, active);
+#else
+#if EV_USE_LAZYTIMERS
+        /* 堆中间的定时器只换成墓碑，不移动任何元素；堆顶和末尾照常移除 */
+        if ((origflags & EVFLAG_LAZYTIMERS) && active > HEAP0 && active < timercnt + HEAP0)
+        {
+            ++timercnt;
+            ANHE_w(timers[active]) = (WT)&timertomb;
+
+            if (expect_false(++timerdead > timercnt >> 1))
+                timers_compact(loop);
+        }
+        else
+#endif
+        if (expect_true(active < timercnt + HEAP0))
+        {
+            timers[active] = timers[timercnt + HEAP0];
+            adjustheap(timers, timercnt, active);
+        }
+#endif
+    }
+
+    ev_at(w) -= mn_now;
+
+    ev_stop(loop, (W)w);
+
+    EV_FREQUENT_CHECK;
+}
+
+void noinline ev_timer_again(struct ev_loop *loop, ev_timer *w) noexcept
+{
+    EV_FREQUENT_CHECK;
+
+    clear_pending(loop, (W)w);
+
+    if (ev_is_active(w))
+    {
+        if (w->repeat)
+        {
+            ev_at(w) = mn_now + EV_TS2KEY(w->repeat);
+            ANHE_at_cache(timers[ev_active(w)]);
+#if EV_USE_TIMERWHEEL
+            /* 频繁重置的超时通常仍落在原来的槽中，这时不需要改动链表 */
+            if (timerwheel_slot(loop, ev_at(w)) != timerlinks[ev_active(w)].slot)
+            {
+                timerwheel_unlink(loop, ev_active(w));
+                timerwheel_link(loop, ev_active(w));
+            }
+#else
+            adjustheap(timers, timercnt, ev_active(w));
+#endif
+        }
+        else
+            ev_timer_stop(loop, w);
+    }
+    else if (w->repeat)
+    {
+        ev_at(w) = EV_TS2KEY(w->repeat);
+        ev_timer_start(loop, w);
+    }
+
+    EV_FREQUENT_CHECK;
+}
+
+ev_tstamp ev_timer_remaining(struct ev_loop *loop, ev_timer *w) noexcept
+{
+    return EV_KEY2TS(ev_at(w) - (ev_is_active(w) ? mn_now : 0));
+}
+
+#if EV_HRTIMER_ENABLE
+void noinline ev_hrtimer_start(struct ev_loop *loop, ev_hrtimer *w) noexcept
+{
+    if (expect_false(ev_is_active(w)))
+        return;
+
+    ev_at(w) += mn_now;
+
+    assert(("libev: ev_hrtimer_start called with negative timer repeat value", w->repeat >= 0.));
+
+    EV_FREQUENT_CHECK;
+
+    ++hrtimercnt;
+    ev_start(loop, (W)w, hrtimercnt + HEAP0 - 1);
+    array_needsize(ANHE, hrtimers, hrtimermax, ev_active(w) + 1, EMPTY2);
+    ANHE_w(hrtimers[ev_active(w)]) = (WT)w;
+    ANHE_at_cache(hrtimers[ev_active(w)]);
+    upheap(hrtimers, ev_active(w));
+
+    EV_FREQUENT_CHECK;
+}
+
+void noinline ev_hrtimer_stop(struct ev_loop *loop, ev_hrtimer *w) noexcept
 {
     clear_pending(loop, (W)w);
     if (expect_false(!ev_is_active(w)))
@@ -2790,14 +4653,14 @@ void noinline ev_timer_stop(struct ev_loop *loop, ev_timer *w) noexcept
     {
         int active = ev_active(w);
 
-        assert(("libev: internal timer heap corruption", ANHE_w(timers[active]) == (WT)w));
+        assert(("libev: internal hrtimer heap corruption", ANHE_w(hrtimers[active]) == (WT)w));
 
-        --timercnt;
+        --hrtimercnt;
 
-        if (expect_true(active < timercnt + HEAP0))
+        if (expect_true(active < hrtimercnt + HEAP0))
         {
-            timers[active] = timers[timercnt + HEAP0];
-            adjustheap(timers, timercnt, active);
+            hrtimers[active] = hrtimers[hrtimercnt + HEAP0];
+            adjustheap(hrtimers, hrtimercnt, active);
         }
     }
 
@@ -2807,37 +4670,7 @@ void noinline ev_timer_stop(struct ev_loop *loop, ev_timer *w) noexcept
 
     EV_FREQUENT_CHECK;
 }
-
-void noinline ev_timer_again(struct ev_loop *loop, ev_timer *w) noexcept
-{
-    EV_FREQUENT_CHECK;
-
-    clear_pending(loop, (W)w);
-
-    if (ev_is_active(w))
-    {
-        if (w->repeat)
-        {
-            ev_at(w) = mn_now + w->repeat;
-            ANHE_at_cache(timers[ev_active(w)]);
-            adjustheap(timers, timercnt, ev_active(w));
-        }
-        else
-            ev_timer_stop(loop, w);
-    }
-    else if (w->repeat)
-    {
-        ev_at(w) = w->repeat;
-        ev_timer_start(loop, w);
-    }
-
-    EV_FREQUENT_CHECK;
-}
-
-ev_tstamp ev_timer_remaining(struct ev_loop *loop, ev_timer *w) noexcept
-{
-    return ev_at(w) - (ev_is_active(w) ? mn_now : 0.);
-}
+#endif
 
 #if EV_PERIODIC_ENABLE
 void noinline ev_periodic_start(struct ev_loop *loop, ev_periodic *w) noexcept
@@ -2846,20 +4679,28 @@ void noinline ev_periodic_start(struct ev_loop *loop, ev_periodic *w) noexcept
         return;
 
     if (w->reschedule_cb)
-        ev_at(w) = w->reschedule_cb(w, ev_rt_now);
+        ev_at(w) = EV_TS2KEY(w->reschedule_cb(w, ev_rt_now));
     else if (w->interval)
     {
         assert(("libev: ev_periodic_start called with negative interval value", w->interval >= 0.));
-        periodic_recalc(loop, w);
+        periodic_recalc(loop, w, ev_rt_now);
     }
     else
-        ev_at(w) = w->offset;
+        ev_at(w) = EV_TS2KEY(w->offset);
 
     EV_FREQUENT_CHECK;
 
     ++periodiccnt;
     ev_start(loop, (W)w, periodiccnt + HEAP0 - 1);
-    array_needsize(ANHE, periodics, periodicmax, ev_active(w) + 1, EMPTY2);
+    array_needsize(ANHE, periodics, periodicmax, ev_active(w) + periodicstale + 1, EMPTY2);
+
+    /* 新的堆尾被尚未重新计算的条目占用，把它移到最后 */
+    if (periodicstale) [[unlikely]]
+    {
+        periodics[ev_active(w) + periodicstale] = periodics[ev_active(w)];
+        ev_active(ANHE_w(periodics[ev_active(w) + periodicstale])) = ev_active(w) + periodicstale;
+    }
+
     ANHE_w(periodics[ev_active(w)]) = (WT)w;
     ANHE_at_cache(periodics[ev_active(w)]);
     upheap(periodics, ev_active(w));
@@ -2882,12 +4723,29 @@ void noinline ev_periodic_stop(struct ev_loop *loop, ev_periodic *w) noexcept
 
         assert(("libev: internal periodic heap corruption", ANHE_w(periodics[active]) == (WT)w));
 
-        --periodiccnt;
-
-        if (expect_true(active < periodiccnt + HEAP0))
+        if (active >= periodiccnt + HEAP0) [[unlikely]]
+        {
+            /* 尚未重新计算的条目不在堆中，用最后一个条目填补 */
+            --periodicstale;
+            periodics[active] = periodics[periodiccnt + periodicstale + HEAP0];
+            ev_active(ANHE_w(periodics[active])) = active;
+        }
+        else
         {
-            periodics[active] = periodics[periodiccnt + HEAP0];
-            adjustheap(periodics, periodiccnt, active);
+            --periodiccnt;
+
+            if (expect_true(active < periodiccnt + HEAP0))
+            {
+                periodics[active] = periodics[periodiccnt + HEAP0];
+                adjustheap(periodics, periodiccnt, active);
+            }
+
+            /* 堆尾空出的位置由最后一个尚未重新计算的条目填补 */
+            if (periodicstale) [[unlikely]]
+            {
+                periodics[periodiccnt + HEAP0] = periodics[periodiccnt + periodicstale + HEAP0];
+                ev_active(ANHE_w(periodics[periodiccnt + HEAP0])) = periodiccnt + HEAP0;
+            }
         }
     }
 
@@ -2904,6 +4762,172 @@ void noinline ev_periodic_again(struct ev_loop *loop, ev_periodic *w) noexcept
 }
 #endif
 
+#if EV_CRON_ENABLE
+/* 60位分钟掩码，多余的高位被忽略 */
+#define EV_CRON_MINUTES 0x0fffffffffffffffULL
+
+/*
+ * ev_cron的重新调度函数，由periodics_reify、periodics_migrate和ev_periodic_start调用
+ * @param pw 日历定时器，布局与ev_periodic相同
+ * @param now 当前实时时间
+ * @return now之后第一个满足规则的整分钟
+ *
+ * 以分钟为单位做整数运算，最多检查今天剩下的部分和之后的7天。
+ */
+static ev_tstamp cron_reschedule(ev_periodic *pw, ev_tstamp now) noexcept
+{
+    ev_cron *w = (ev_cron *)pw;
+    int64_t minute = (int64_t)ev_floor((now + w->tzoff) / 60.) + 1;
+    int64_t day = minute / 1440;
+    int mod = (int)(minute % 1440);
+    int i;
+
+    if (mod < 0)
+    {
+        mod += 1440;
+        --day;
+    }
+
+    for (i = 8; i--; ++day, mod = 0)
+    {
+        /* 1970-01-01是星期四 */
+        int wday = (int)(((day + 4) % 7 + 7) % 7);
+        int h, m;
+
+        if (!(w->wdays >> wday & 1))
+            continue;
+
+        for (h = mod / 60, m = mod % 60; h < 24; ++h, m = 0)
+        {
+            uint64_t mm = (w->minutes & EV_CRON_MINUTES) >> m;
+
+            if ((w->hours >> h & 1) && mm)
+                return (ev_tstamp)((day * 1440 + h * 60 + m + ecb_ctz64(mm)) * 60 - w->tzoff);
+        }
+    }
+
+    /* 启动后规则被改为空，不再触发 */
+    return now + 1e9;
+}
+
+void noinline ev_cron_start(struct ev_loop *loop, ev_cron *w) noexcept
+{
+    if (expect_false(ev_is_active(w)))
+        return;
+
+    assert(("libev: ev_cron_start called with an empty schedule",
+            (w->minutes & EV_CRON_MINUTES) && (w->hours & 0xffffff) && (w->wdays & 0x7f)));
+
+    w->offset = 0.;
+    w->interval = 0.;
+    w->reschedule_cb = cron_reschedule;
+
+    ev_periodic_start(loop, (ev_periodic *)w);
+}
+
+void noinline ev_cron_stop(struct ev_loop *loop, ev_cron *w) noexcept
+{
+    ev_periodic_stop(loop, (ev_periodic *)w);
+}
+
+/*
+ * 解析ev_cron_set_spec的一个字段
+ * @param p 字段开始的位置，可以有前导空白
+ * @param lo 允许的最小值
+ * @param hi 允许的最大值
+ * @param mask 返回字段对应的位掩码
+ * @return 字段之后的位置，格式错误时返回0
+ */
+static const char *cron_field(const char *p, int lo, int hi, uint64_t *mask)
+{
+    uint64_t bits = 0;
+
+    while (*p == ' ' || *p == '\t')
+        ++p;
+
+    for (;;)
+    {
+        int a = lo, b = hi, step = 1;
+
+        if (*p == '*')
+            ++p;
+        else
+        {
+            if (*p < '0' || *p > '9')
+                return 0;
+
+            for (a = 0; *p >= '0' && *p <= '9' && a < 100; ++p)
+                a = a * 10 + *p - '0';
+
+            b = a;
+
+            if (*p == '-')
+            {
+                if (*++p < '0' || *p > '9')
+                    return 0;
+
+                for (b = 0; *p >= '0' && *p <= '9' && b < 100; ++p)
+                    b = b * 10 + *p - '0';
+            }
+            else if (*p == '/')
+                b = hi; /* "a/step"与"a-hi/step"相同 */
+        }
+
+        if (*p == '/')
+        {
+            if (*++p < '0' || *p > '9')
+                return 0;
+
+            for (step = 0; *p >= '0' && *p <= '9' && step < 100; ++p)
+                step = step * 10 + *p - '0';
+
+            if (!step)
+                return 0;
+        }
+
+        if (a < lo || b > hi || a > b)
+            return 0;
+
+        for (; a <= b; a += step)
+            bits |= (uint64_t)1 << a;
+
+        if (*p != ',')
+            break;
+
+        ++p;
+    }
+
+    if (*p && *p != ' ' && *p != '\t')
+        return 0;
+
+    *mask = bits;
+    return p;
+}
+
+int ev_cron_set_spec(ev_cron *w, const char *spec, int tzoff) noexcept
+{
+    uint64_t minutes, hours, wdays;
+
+    if (!(spec = cron_field(spec, 0, 59, &minutes))
+        || !(spec = cron_field(spec, 0, 23, &hours))
+        || !(spec = cron_field(spec, 0, 7, &wdays)))
+        return -1;
+
+    while (*spec == ' ' || *spec == '\t')
+        ++spec;
+
+    if (*spec)
+        return -1;
+
+    /* 7和0都表示星期日 */
+    wdays = (wdays | wdays >> 7) & 0x7f;
+
+    ev_cron_set(w, minutes, (uint32_t)hours, (uint32_t)wdays, tzoff);
+
+    return 0;
+}
+#endif
+
 #ifndef SA_RESTART
 #define SA_RESTART 0
 #endif
@@ -3693,6 +5717,186 @@ void ev_cleanup_stop(struct ev_loop *loop, ev_cleanup *w) noexcept
 }
 #endif
 
+#if EV_DEADLINE_ENABLE
+/* 从组的FIFO中摘下监视器 */
+inline_speed void deadline_unlink(ANDL *g, ev_deadline *w)
+{
+    if (w->prev)
+        w->prev->next = w->next;
+    else
+        g->head = w->next;
+
+    if (w->next)
+        w->next->prev = w->prev;
+    else
+        g->tail = w->prev;
+}
+
+/* 把监视器挂到组的FIFO末尾，组内timeout相同，所以末尾总是最晚超时的 */
+inline_speed void deadline_append(ANDL *g, ev_deadline *w)
+{
+    w->next = 0;
+    w->prev = g->tail;
+
+    if (g->tail)
+        g->tail->next = w;
+    else
+        g->head = w;
+
+    g->tail = w;
+}
+
+/* 组已空，停止组定时器并释放组 */
+static void noinline deadline_release(struct ev_loop *loop, ANDL *g)
+{
+    deadlinegroups[g->index] = deadlinegroups[--deadlinegroupcnt];
+    deadlinegroups[g->index]->index = g->index;
+
+    ev_ref(loop);
+    ev_timer_stop(loop, &g->timer);
+    ev_free(g);
+}
+
+/*
+ * 按队首的最后活动时间重新设置组定时器
+ * 组定时器不占循环引用，只有用户的ev_deadline让循环保持运行，与ev_stat的内部定时器相同
+ */
+inline_speed void deadline_arm(struct ev_loop *loop, ANDL *g)
+{
+    if (ev_is_active(&g->timer))
+    {
+        ev_ref(loop);
+        ev_timer_stop(loop, &g->timer);
+    }
+
+    ev_at(&g->timer) = g->head->last_activity + EV_TS2KEY(g->timeout) - mn_now;
+    ev_timer_start(loop, &g->timer);
+    ev_unref(loop);
+}
+
+/*
+ * 组定时器回调
+ * touch不会改动定时器，所以它可能早于队首的真实超时触发，这时只需按新的队首重新设置
+ */
+static void deadline_cb(struct ev_loop *loop, ev_timer *w, int revents)
+{
+    ANDL *g = (ANDL *)(((char *)w) - offsetof(ANDL, timer));
+    ev_timekey timeout = EV_TS2KEY(g->timeout);
+
+    while (g->head && g->head->last_activity + timeout <= mn_now)
+    {
+        ev_deadline *d = g->head;
+
+        deadline_unlink(g, d);
+        ev_stop(loop, (W)d);
+        ev_feed_event(loop, d, EV_TIMER);
+    }
+
+    if (g->head)
+        deadline_arm(loop, g);
+    else
+        deadline_release(loop, g);
+}
+
+void noinline ev_deadline_start(struct ev_loop *loop, ev_deadline *w) noexcept
+{
+    ANDL *g = 0;
+    int i;
+
+    if (expect_false(ev_is_active(w)))
+        return;
+
+    assert(("libev: ev_deadline_start called with negative timeout value", w->timeout >= 0.));
+
+    EV_FREQUENT_CHECK;
+
+    /* 不同的timeout通常只有几个，线性查找即可 */
+    for (i = 0; i < deadlinegroupcnt; ++i)
+        if (deadlinegroups[i]->timeout == w->timeout)
+        {
+            g = deadlinegroups[i];
+            break;
+        }
+
+    if (!g)
+    {
+        /* 组单独分配，数组扩容时内部定时器的地址不能变 */
+        g = (ANDL *)ev_malloc(sizeof(ANDL));
+        g->timeout = w->timeout;
+        g->head = g->tail = 0;
+        g->index = deadlinegroupcnt++;
+        ev_init(&g->timer, deadline_cb);
+        ev_set_priority(&g->timer, EV_MAXPRI);
+        /* 重复定时器不会被timers_reify停止，引用计数只由deadline_arm和deadline_release调整 */
+        g->timer.repeat = g->timeout > 0. ? g->timeout : MIN_INTERVAL;
+
+        array_needsize(ANDL *, deadlinegroups, deadlinegroupmax, deadlinegroupcnt, EMPTY2);
+        deadlinegroups[g->index] = g;
+    }
+
+    w->last_activity = mn_now;
+    w->group = g;
+    ev_start(loop, (W)w, 1);
+    deadline_append(g, w);
+
+    if (!ev_is_active(&g->timer))
+        deadline_arm(loop, g);
+
+    EV_FREQUENT_CHECK;
+}
+
+void noinline ev_deadline_stop(struct ev_loop *loop, ev_deadline *w) noexcept
+{
+    clear_pending(loop, (W)w);
+    if (expect_false(!ev_is_active(w)))
+        return;
+
+    EV_FREQUENT_CHECK;
+
+    {
+        ANDL *g = (ANDL *)w->group;
+
+        /* 停止队首时不改动定时器，到时再按新的队首重新设置 */
+        deadline_unlink(g, w);
+        ev_stop(loop, (W)w);
+
+        if (!g->head)
+            deadline_release(loop, g);
+    }
+
+    EV_FREQUENT_CHECK;
+}
+
+void ev_deadline_touch(struct ev_loop *loop, ev_deadline *w) noexcept
+{
+    clear_pending(loop, (W)w);
+
+    if (expect_false(!ev_is_active(w)))
+    {
+        ev_deadline_start(loop, w);
+        return;
+    }
+
+    w->last_activity = mn_now;
+
+    /* 只移到FIFO末尾，O(1)且不动定时器堆 */
+    {
+        ANDL *g = (ANDL *)w->group;
+
+        if (g->tail != w)
+        {
+            deadline_unlink(g, w);
+            deadline_append(g, w);
+        }
+    }
+}
+
+ev_tstamp ev_deadline_remaining(struct ev_loop *loop, ev_deadline *w) noexcept
+{
+    return ev_is_active(w) ? EV_KEY2TS(w->last_activity + EV_TS2KEY(w->timeout) - mn_now) : w->timeout;
+}
+#endif
+
 #if EV_ASYNC_ENABLE
 void ev_async_start(struct ev_loop *loop, ev_async *w) noexcept
 {
@@ -3737,6 +5941,76 @@ void ev_async_send(struct ev_loop *loop, ev_async *w) noexcept
     w->sent = 1;
     evpipe_write(loop, &async_pending);
 }
+
+void ev_set_feed_mt_size(struct ev_loop *loop, int size) noexcept
+{
+    /* 容量为1时"已写入"与"可写入"的序号相同，无法区分 */
+    unsigned int cap = 2, i;
+
+    /* 投递线程可能已经在使用现有的队列 */
+    if (feedmt)
+        return;
+
+    /* 序号差按int比较，容量不能超过2**30 */
+    if (size > 1 << 30)
+        size = 1 << 30;
+
+    while ((int)cap < size)
+        cap <<= 1;
+
+    feedmt = (ANFEED *)ev_malloc(sizeof(ANFEED) * cap);
+    for (i = 0; i < cap; ++i)
+        feedmt[i].seq = i;
+
+    feedmtmask = cap - 1;
+    feedmthead = 0;
+    feedmttail = 0;
+
+    evpipe_init(loop);
+
+    ECB_MEMORY_FENCE_RELEASE;
+}
+
+int ev_feed_event_mt(struct ev_loop *loop, void *w, int revents) noexcept
+{
+    std::atomic_ref<unsigned int> head(feedmthead);
+    unsigned int pos = head.load(std::memory_order_relaxed);
+    ANFEED *cell;
+
+    assert(("libev: ev_feed_event_mt called before ev_set_feed_mt_size", feedmt));
+
+    /* 抢占写入序号pos，格子的seq落后于pos说明队列已满 */
+    for (;;)
+    {
+        int dif;
+
+        cell = feedmt + (pos & feedmtmask);
+        dif = (int)(std::atomic_ref<unsigned int>(cell->seq).load(std::memory_order_acquire) - pos);
+
+        if (dif == 0)
+        {
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (dif < 0)
+        {
+            /* 确保循环会来取走已有的事件 */
+            evpipe_write(loop, &feedmt_pending);
+            return 0;
+        }
+        else
+            pos = head.load(std::memory_order_relaxed);
+    }
+
+    cell->w = (W)w;
+    cell->events = revents;
+    std::atomic_ref<unsigned int>(cell->seq).store(pos + 1, std::memory_order_release);
+
+    /* 标志已置位时只有一次屏障，循环阻塞在后端中时才写管道 */
+    evpipe_write(loop, &feedmt_pending);
+
+    return 1;
+}
 #endif
 
 /*****************************************************************************/
@@ -3839,6 +6113,11 @@ void __cold ev_walk(struct ev_loop *loop, int types, void (*cb)(struct ev_loop *
 
     if (types & (EV_TIMER | EV_STAT))
         for (i = timercnt + HEAP0; i-- > HEAP0;)
+#if EV_USE_LAZYTIMERS
+            if (ANHE_w(timers[i]) == (WT)&timertomb)
+                ; /* 已停止的定时器 */
+            else
+#endif
 #if EV_STAT_ENABLE
             /*TODO: timer is not always active*/
             if (ev_cb((ev_timer *)ANHE_w(timers[i])) == stat_timer_cb)
@@ -3851,9 +6130,15 @@ void __cold ev_walk(struct ev_loop *loop, int types, void (*cb)(struct ev_loop *
                 if (types & EV_TIMER)
                 cb(loop, EV_TIMER, ANHE_w(timers[i]));
 
+#if EV_HRTIMER_ENABLE
+    if (types & EV_TIMER)
+        for (i = hrtimercnt + HEAP0; i-- > HEAP0;)
+            cb(loop, EV_TIMER, ANHE_w(hrtimers[i]));
+#endif
+
 #if EV_PERIODIC_ENABLE
     if (types & EV_PERIODIC)
-        for (i = periodiccnt + HEAP0; i-- > HEAP0;)
+        for (i = periodiccnt + periodicstale + HEAP0; i-- > HEAP0;)
             cb(loop, EV_PERIODIC, ANHE_w(periodics[i]));
 #endif
 
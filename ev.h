@@ -92,6 +92,18 @@ EV_CPP(extern "C" {)
 #define EV_CLEANUP_ENABLE EV_FEATURE_WATCHERS
 #endif
 
+#ifndef EV_DEADLINE_ENABLE
+#define EV_DEADLINE_ENABLE EV_FEATURE_WATCHERS
+#endif
+
+#ifndef EV_CRON_ENABLE
+#define EV_CRON_ENABLE EV_FEATURE_WATCHERS
+#endif
+
+#ifndef EV_HRTIMER_ENABLE
+#define EV_HRTIMER_ENABLE EV_FEATURE_WATCHERS
+#endif
+
 #ifndef EV_SIGNAL_ENABLE
 #define EV_SIGNAL_ENABLE EV_FEATURE_WATCHERS
 #endif
@@ -121,11 +133,26 @@ EV_CPP(extern "C" {)
 #define EV_SIGNAL_ENABLE 1
 #endif
 
+#if EV_CRON_ENABLE && !EV_PERIODIC_ENABLE
+#undef EV_PERIODIC_ENABLE
+#define EV_PERIODIC_ENABLE 1
+#endif
+
 /*****************************************************************************/
 
 /* 时间戳类型定义，使用双精度浮点数表示，单位为秒 */
 typedef double ev_tstamp;
 
+#include <stdint.h>
+
+/* 以纳秒为单位的整数时间戳 */
+typedef int64_t ev_tstamp_ns;
+
+/* 定时器内部以整数纳秒保存到期时刻，库和使用者必须以相同的设置编译 */
+#ifndef EV_TSTAMP_INT64
+#define EV_TSTAMP_INT64 0
+#endif
+
 #include <string.h> /* for memmove */
 
 #ifndef EV_ATOMIC_T
@@ -177,6 +204,38 @@ typedef double ev_tstamp;
 #define EV_API_DECL extern
 #endif
 
+/*
+ * 定时器堆中保存的时刻(私有)
+ * EV_TSTAMP_INT64时是整数纳秒，堆比较是精确的，获取单调时钟也不需要浮点转换；
+ * 否则与ev_tstamp相同。公开的接口仍然使用ev_tstamp，在边界上用下面的宏转换
+ */
+#if EV_TSTAMP_INT64
+typedef int64_t ev_timekey;
+
+/* 四舍五入到纳秒，超出约±126年的值被截断，相加时不会溢出 */
+EV_INLINE ev_timekey ev_timekey_from_ts(ev_tstamp t)
+{
+    if (t > 4e9)
+        return (ev_timekey)4000000000000000000LL;
+    if (t < -4e9)
+        return -(ev_timekey)4000000000000000000LL;
+
+    return (ev_timekey)(t * 1e9 + (t < 0. ? -.5 : .5));
+}
+
+#define EV_TS2KEY(t) ev_timekey_from_ts(t)
+#define EV_KEY2TS(k) ((ev_tstamp)(k) * 1e-9)
+#define EV_NS2KEY(n) ((ev_timekey)(n))
+#define EV_KEY2NS(k) ((ev_tstamp_ns)(k))
+#else
+typedef ev_tstamp ev_timekey;
+
+#define EV_TS2KEY(t) ((ev_timekey)(t))
+#define EV_KEY2TS(k) ((ev_tstamp)(k))
+#define EV_NS2KEY(n) ((ev_timekey)(n) * 1e-9)
+#define EV_KEY2NS(k) ((ev_tstamp_ns)((k) * 1e9))
+#endif
+
 /* EV_PROTOTYPES can be used to switch of prototype declarations */
 #ifndef EV_PROTOTYPES
 #define EV_PROTOTYPES 1
@@ -193,6 +252,8 @@ typedef double ev_tstamp;
         EV_NONE = 0x00,             /* 无事件 */
         EV_READ = 0x01,             /* ev_io检测到读取操作不会阻塞 */
         EV_WRITE = 0x02,            /* ev_io检测到写入操作不会阻塞 */
+        EV_EXCLUSIVE = 0x20,        /* ev_io请求独占唤醒(epoll EPOLLEXCLUSIVE)，用于多个循环共享的监听fd，其他后端忽略 */
+        EV_ET = 0x40,               /* ev_io请求边沿触发(epoll/io_uring/kqueue)，其他后端忽略 */
         EV__IOFDSET = 0x80,         /* 仅内部使用 */
         EV_IO = EV_READ,            /* 用于类型检测的别名 */
         EV_TIMER = 0x00000100,      /* 定时器超时 */
@@ -249,7 +310,7 @@ typedef double ev_tstamp;
 
 #define EV_WATCHER_TIME(type) \
     EV_WATCHER(type)          \
-    ev_tstamp at; /* private */
+    ev_timekey at; /* private */
 
     /* 基础类，除非你要继承它，否则无需关注 */
     /* 
@@ -287,7 +348,7 @@ typedef struct ev_watcher {
         int priority;  /* 优先级 */
         void *data;    /* 用户数据 */
         void (*cb)(struct ev_loop *loop, struct ev_watcher_time *w, int revents); /* 回调函数 */
-        ev_tstamp at;  /* 下次触发的时间戳 */
+        ev_timekey at; /* 下次触发的时间戳 */
     } ev_watcher_time;
 
     /* 当文件描述符(fd)可读(EV_READ)或可写(EV_WRITE)时被调用 */
@@ -304,6 +365,16 @@ typedef struct ev_watcher {
         ev_tstamp repeat; /* 可读写 */
     } ev_timer;
 
+#if EV_HRTIMER_ENABLE
+    /* 高精度定时器：循环只阻塞到到期前hires_margin秒，之后自旋读取时钟直到到期时刻 */
+    /* 使用独立的堆，普通定时器不受影响；EVFLAG_COARSE_CLOCK下不自旋，与普通定时器相同 */
+    /* 事件类型：EV_TIMER */
+    typedef struct ev_hrtimer {
+        EV_WATCHER_TIME(ev_hrtimer)
+        ev_tstamp repeat; /* 可读写 */
+    } ev_hrtimer;
+#endif
+
     /* 在特定时间触发，可能基于UTC时间定期重复执行 */
     /* 事件类型：EV_PERIODIC（周期性事件） */
     typedef struct ev_periodic {
@@ -314,6 +385,24 @@ typedef struct ev_watcher {
         ev_tstamp (*reschedule_cb)(struct ev_periodic *w, ev_tstamp now) noexcept; /* 可读写 重新调度回调函数 */
     } ev_periodic;
 
+#if EV_CRON_ENABLE
+    /* 在满足分钟/小时/星期几规则的每个整分钟触发，与ev_periodic共用一个堆 */
+    /* 下次触发时刻由整数日历运算得到，不调用用户代码，也不调用localtime */
+    /* 事件类型：EV_PERIODIC */
+    typedef struct ev_cron {
+        EV_WATCHER_TIME(ev_cron)
+
+        ev_tstamp offset;                                                          /* 私有 与ev_periodic布局相同 */
+        ev_tstamp interval;                                                        /* 私有 */
+        ev_tstamp (*reschedule_cb)(struct ev_periodic *w, ev_tstamp now) noexcept; /* 私有 */
+
+        uint64_t minutes; /* 可读写 允许的分钟(0-59)位掩码 */
+        uint32_t hours;   /* 可读写 允许的小时(0-23)位掩码 */
+        uint32_t wdays;   /* 可读写 允许的星期几(0-6，0为星期日)位掩码 */
+        int32_t tzoff;    /* 可读写 本地时间相对UTC的偏移(秒)，不处理夏令时 */
+    } ev_cron;
+#endif
+
     /* 当接收到指定信号时被调用 */
     /* 重新事件 EV_SIGNAL */
     typedef struct ev_signal {
@@ -388,6 +477,19 @@ typedef struct ev_watcher {
     } ev_cleanup;
 #endif
 
+#if EV_DEADLINE_ENABLE
+    /* 空闲超时：从最后一次ev_deadline_touch起timeout秒内没有再次touch时调用，触发后自动停止 */
+    /* 事件类型：EV_TIMER */
+    typedef struct ev_deadline {
+        EV_WATCHER(ev_deadline)
+
+        ev_tstamp timeout;               /* 只读 */
+        ev_timekey last_activity;        /* 私有 最后一次活动的单调时间 */
+        struct ev_deadline *next, *prev; /* 私有 同一时长的FIFO链表 */
+        void *group;                     /* 私有 */
+    } ev_deadline;
+#endif
+
 #if EV_EMBED_ENABLE
     /* 用于将一个事件循环嵌入到另一个事件循环中 */
     /* 当事件循环处理完事件后会调用该回调函数，该回调可设为0 */
@@ -427,7 +529,13 @@ typedef struct ev_watcher {
 
         struct ev_io io;
         struct ev_timer timer;
+#if EV_HRTIMER_ENABLE
+        struct ev_hrtimer hrtimer;
+#endif
         struct ev_periodic periodic;
+#if EV_CRON_ENABLE
+        struct ev_cron cron;
+#endif
         struct ev_signal signal;
         struct ev_child child;
 #if EV_STAT_ENABLE
@@ -444,6 +552,9 @@ typedef struct ev_watcher {
 #if EV_CLEANUP_ENABLE
         struct ev_cleanup cleanup;
 #endif
+#if EV_DEADLINE_ENABLE
+        struct ev_deadline deadline;
+#endif
 #if EV_EMBED_ENABLE
         struct ev_embed embed;
 #endif
@@ -459,13 +570,17 @@ typedef struct ev_watcher {
         /* 标志位 */
         EVFLAG_NOENV = 0x01000000U,     /* 不读取环境变量 */
         EVFLAG_FORKCHECK = 0x02000000U, /* 每次迭代检查fork事件 */
+        EVFLAG_LAZYTIMERS = 0x04000000U, /* ev_timer_stop只在堆中留下墓碑，稍后批量移除 */
+        EVFLAG_TSCCLOCK = 0x08000000U,   /* 用校准过的不变TSC读取单调时钟，不支持时退回clock_gettime */
+        EVFLAG_COARSE_CLOCK = 0x10000000U, /* 用*_COARSE时钟读取时间，精度降为一个时钟节拍 */
         /* 调试/功能禁用 */
         EVFLAG_NOINOTIFY = 0x00100000U, /* 禁止使用inotify */
 #if EV_COMPAT3
         EVFLAG_NOSIGFD = 0, /* 兼容3.9之前版本 */
 #endif
         EVFLAG_SIGNALFD = 0x00200000U, /* 尝试使用signalfd */
-        EVFLAG_NOSIGMASK = 0x00400000U /* 避免修改信号掩码 */
+        EVFLAG_NOSIGMASK = 0x00400000U, /* 避免修改信号掩码 */
+        EVFLAG_TIMERFD = 0x00800000U    /* 用timerfd按绝对时刻唤醒定时器 */
     };
 
     /* 需要按位或组合的方法标志位 */
@@ -476,8 +591,10 @@ typedef struct ev_watcher {
         EVBACKEND_KQUEUE = 0x00000008U, /* bsd */
         EVBACKEND_DEVPOLL = 0x00000010U,
         /* solaris 8 */               /* NYI */
-        EVBACKEND_PORT = 0x00000020U, /* solaris 10 */
-        EVBACKEND_ALL = 0x0000003FU,  /* all known backends */
+        EVBACKEND_PORT = 0x00000020U,     /* solaris 10 */
+        EVBACKEND_LINUXAIO = 0x00000040U, /* linux 4.19+ */
+        EVBACKEND_IOURING = 0x00000080U,  /* linux 5.6+ */
+        EVBACKEND_ALL = 0x000000FFU,      /* all known backends */
         EVBACKEND_MASK = 0x0000FFFFU  /* all future backends */
     };
 
@@ -628,6 +745,9 @@ typedef struct ev_watcher {
 
     EV_API_DECL void ev_now_update(struct ev_loop * loop) noexcept; /* update event loop time */
 
+    /* 循环缓存的单调时钟时间(纳秒)，起点不确定，不是ev_now那样的实时时间，只用于计算间隔；EV_TSTAMP_INT64时没有精度损失 */
+    EV_API_DECL ev_tstamp_ns ev_mono_now_ns(struct ev_loop * loop) noexcept;
+
 #if EV_WALK_ENABLE
     /* 遍历指定类型的所有（近乎全部）监视器，对每个监视器调用回调函数 */
     /* 回调函数可以停止监视器，但不对事件循环进行其他操作 */
@@ -694,6 +814,8 @@ typedef struct ev_watcher {
 
     EV_API_DECL void ev_set_io_collect_interval(struct ev_loop * loop, ev_tstamp interval) noexcept;      /* sleep at least this time, default 0 */
     EV_API_DECL void ev_set_timeout_collect_interval(struct ev_loop * loop, ev_tstamp interval) noexcept; /* sleep at least this time, default 0 */
+    EV_API_DECL void ev_set_busy_poll(struct ev_loop * loop, ev_tstamp budget) noexcept;                  /* spin up to this time before blocking, default 0 */
+    EV_API_DECL void ev_set_timer_slack(struct ev_loop * loop, ev_tstamp slack) noexcept;                 /* timeouts may fire up to this late, default 0 */
 
     /* advanced stuff for threading etc. support, see docs */
     EV_API_DECL void ev_set_userdata(struct ev_loop * loop, void *data) noexcept;
@@ -733,13 +855,24 @@ typedef struct ev_watcher {
         (ev)->events = (events_) | EV__IOFDSET; \
     } while (0)
 
-#define ev_timer_set(ev, after_, repeat_)         \
-    do                                            \
-    {                                             \
-        ((ev_watcher_time *)(ev))->at = (after_); \
-        (ev)->repeat = (repeat_);                 \
+#define ev_timer_set(ev, after_, repeat_)                  \
+    do                                                     \
+    {                                                      \
+        ((ev_watcher_time *)(ev))->at = EV_TS2KEY(after_); \
+        (ev)->repeat = (repeat_);                          \
     } while (0)
 
+/* 以纳秒设置定时器，EV_TSTAMP_INT64时首次到期时刻是精确的 */
+#define ev_timer_set_ns(ev, after_ns_, repeat_ns_)            \
+    do                                                        \
+    {                                                         \
+        ((ev_watcher_time *)(ev))->at = EV_NS2KEY(after_ns_); \
+        (ev)->repeat = (ev_tstamp)(repeat_ns_) * 1e-9;        \
+    } while (0)
+
+/* ev_hrtimer与ev_timer的字段相同 */
+#define ev_hrtimer_set(ev, after_, repeat_) ev_timer_set((ev), (after_), (repeat_))
+
 #define ev_periodic_set(ev, ofs_, ival_, rcb_) \
     do                                         \
     {                                          \
@@ -780,6 +913,19 @@ typedef struct ev_watcher {
 
 #define ev_fork_set(ev)    /* nop, yes, this is a serious in-joke */
 #define ev_cleanup_set(ev) /* nop, yes, this is a serious in-joke */
+#define ev_deadline_set(ev, timeout_) \
+    do                                \
+    {                                 \
+        (ev)->timeout = (timeout_);   \
+    } while (0)
+#define ev_cron_set(ev, minutes_, hours_, wdays_, tzoff_) \
+    do                                                    \
+    {                                                     \
+        (ev)->minutes = (minutes_);                       \
+        (ev)->hours = (hours_);                           \
+        (ev)->wdays = (wdays_);                           \
+        (ev)->tzoff = (tzoff_);                           \
+    } while (0)
 #define ev_async_set(ev)   /* nop, yes, this is a serious in-joke */
 
 #define ev_io_init(ev, cb, fd, events)   \
@@ -795,6 +941,12 @@ typedef struct ev_watcher {
         ev_init((ev), (cb));                   \
         ev_timer_set((ev), (after), (repeat)); \
     } while (0)
+#define ev_hrtimer_init(ev, cb, after, repeat)   \
+    do                                           \
+    {                                            \
+        ev_init((ev), (cb));                     \
+        ev_hrtimer_set((ev), (after), (repeat)); \
+    } while (0)
 #define ev_periodic_init(ev, cb, ofs, ival, rcb)     \
     do                                               \
     {                                                \
@@ -862,6 +1014,20 @@ typedef struct ev_watcher {
         ev_cleanup_set((ev));   \
     } while (0)
 
+#define ev_deadline_init(ev, cb, timeout) \
+    do                                    \
+    {                                     \
+        ev_init((ev), (cb));              \
+        ev_deadline_set((ev), (timeout)); \
+    } while (0)
+
+#define ev_cron_init(ev, cb, minutes, hours, wdays, tzoff)       \
+    do                                                           \
+    {                                                            \
+        ev_init((ev), (cb));                                     \
+        ev_cron_set((ev), (minutes), (hours), (wdays), (tzoff)); \
+    } while (0)
+
 #define ev_async_init(ev, cb) \
     do                        \
     {                         \
@@ -883,7 +1049,7 @@ typedef struct ev_watcher {
 #define ev_set_priority(ev, pri) ((ev_watcher *)(void *)(ev))->priority = (pri)
 #endif
 
-#define ev_periodic_at(ev) (+((ev_watcher_time *)(ev))->at)
+#define ev_periodic_at(ev) EV_KEY2TS(((ev_watcher_time *)(ev))->at)
 
 #ifndef ev_set_cb // TODO
 #define ev_set_cb(ev, cb_) (ev_cb_(ev) = (cb_), memmove(&((ev_watcher *)(ev))->cb, &ev_cb_(ev), sizeof(ev_cb_(ev))))
@@ -971,6 +1137,8 @@ typedef struct ev_watcher {
      */
     /* 启动定时器 */
     EV_API_DECL void ev_timer_start(struct ev_loop * loop, ev_timer * w) noexcept;
+    /* 批量启动n个定时器，大批量时用O(n)的建堆代替逐个插入 */
+    EV_API_DECL void ev_timer_start_many(struct ev_loop * loop, ev_timer * *ws, int n) noexcept;
     /* 停止定时器 */
     EV_API_DECL void ev_timer_stop(struct ev_loop * loop, ev_timer * w) noexcept;
     /* 
@@ -991,6 +1159,24 @@ typedef struct ev_watcher {
      */
     EV_API_DECL ev_tstamp ev_timer_remaining(struct ev_loop * loop, ev_timer * w) noexcept;
 
+#if EV_HRTIMER_ENABLE
+    /*
+     * 高精度定时器监视器操作函数
+     */
+    /* 启动高精度定时器 */
+    EV_API_DECL void ev_hrtimer_start(struct ev_loop * loop, ev_hrtimer * w) noexcept;
+    /* 停止高精度定时器 */
+    EV_API_DECL void ev_hrtimer_stop(struct ev_loop * loop, ev_hrtimer * w) noexcept;
+    /*
+     * 设置高精度定时器的自旋余量
+     * 参数：
+     *   loop: 事件循环指针
+     *   margin: 循环阻塞到最早的高精度定时器到期前margin秒，余下的时间自旋等待，
+     *           应大于后端的唤醒误差，默认EV_HIRES_MARGIN(200微秒)
+     */
+    EV_API_DECL void ev_set_hires_margin(struct ev_loop * loop, ev_tstamp margin) noexcept;
+#endif
+
 #if EV_PERIODIC_ENABLE
     /*
      * 周期性定时器监视器操作函数
@@ -1003,6 +1189,26 @@ typedef struct ev_watcher {
     EV_API_DECL void ev_periodic_again(struct ev_loop * loop, ev_periodic * w) noexcept;
 #endif
 
+#if EV_CRON_ENABLE
+    /*
+     * 日历定时器监视器操作函数
+     */
+    /* 启动日历定时器，三个掩码都不能为空 */
+    EV_API_DECL void ev_cron_start(struct ev_loop * loop, ev_cron * w) noexcept;
+    /* 停止日历定时器 */
+    EV_API_DECL void ev_cron_stop(struct ev_loop * loop, ev_cron * w) noexcept;
+    /*
+     * 按"分钟 小时 星期几"格式的规则设置掩码，例如"0,30 9-17 1-5"表示工作日9点到17点每半小时
+     * 参数：
+     *   w: 日历定时器监视器指针，不能处于激活状态
+     *   spec: 三个以空白分隔的字段，每个字段是以逗号分隔的*、数字或a-b范围，后面可以跟/步长，星期日为0或7
+     *   tzoff: 本地时间相对UTC的偏移(秒)
+     * 返回值：
+     *   成功返回0，格式错误或某个字段为空时返回-1，w不变
+     */
+    EV_API_DECL int ev_cron_set_spec(ev_cron * w, const char *spec, int tzoff) noexcept;
+#endif
+
 /* only supported in the default loop */
 #if EV_SIGNAL_ENABLE
     /*
@@ -1094,6 +1300,21 @@ typedef struct ev_watcher {
     EV_API_DECL void ev_cleanup_stop(struct ev_loop * loop, ev_cleanup * w) noexcept;
 #endif
 
+#if EV_DEADLINE_ENABLE
+    /*
+     * 空闲超时监视器操作函数
+     * 相同timeout的监视器共享一个FIFO和一个内部定时器，touch只记录时间，不调整定时器堆
+     */
+    /* 启动空闲超时监视器，以当前时间作为最后一次活动时间 */
+    EV_API_DECL void ev_deadline_start(struct ev_loop * loop, ev_deadline * w) noexcept;
+    /* 停止空闲超时监视器 */
+    EV_API_DECL void ev_deadline_stop(struct ev_loop * loop, ev_deadline * w) noexcept;
+    /* 记录一次活动，超时从现在重新计算；监视器未激活时等同于ev_deadline_start */
+    EV_API_DECL void ev_deadline_touch(struct ev_loop * loop, ev_deadline * w) noexcept;
+    /* 获取距超时的剩余时间，未激活时返回timeout */
+    EV_API_DECL ev_tstamp ev_deadline_remaining(struct ev_loop * loop, ev_deadline * w) noexcept;
+#endif
+
 #if EV_EMBED_ENABLE
     /*
      * 嵌入式事件循环操作函数
@@ -1119,6 +1340,28 @@ typedef struct ev_watcher {
     EV_API_DECL void ev_async_stop(struct ev_loop * loop, ev_async * w) noexcept;
     /* 发送异步事件通知 */
     EV_API_DECL void ev_async_send(struct ev_loop * loop, ev_async * w) noexcept;
+    /*
+     * 创建ev_feed_event_mt使用的投递队列
+     * 参数：
+     *   loop: 事件循环指针
+     *   size: 队列容量，向上取整到2的幂，不小于2，不超过2**30
+     * 说明：
+     *   必须在循环线程中、其他线程开始投递之前调用，队列已存在时不做任何事
+     */
+    EV_API_DECL void ev_set_feed_mt_size(struct ev_loop * loop, int size) noexcept;
+    /*
+     * 从任意线程向监视器注入事件，多个线程可以同时调用
+     * 参数：
+     *   loop: 事件循环指针
+     *   w: 监视器指针
+     *   revents: 要触发的事件类型
+     * 返回值：
+     *   1表示已投递；0表示队列已满，事件没有投递，调用者应稍后重试
+     * 说明：
+     *   事件在循环下一次处理信号/异步管道时进入待处理队列，与ev_feed_event的效果相同，
+     *   循环阻塞在后端中时才写管道唤醒它。事件取出之前监视器不能释放
+     */
+    EV_API_DECL int ev_feed_event_mt(struct ev_loop * loop, void *w, int revents) noexcept;
 #endif
 
 /*---------------------------------------------------------------------*/
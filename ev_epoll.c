@@ -11,6 +11,10 @@
  * e) epoll声称支持嵌入式使用，但实际上你永远不会从epoll fd上获取就绪事件
  *    （2.6.26及以下版本存在此缺陷，2.6.32及以上版本已修复）。
  * f) 当epoll_ctl返回EPERM错误时，表示该fd始终处于就绪状态。
+ * g) EPOLLEXCLUSIVE只能在EPOLL_CTL_ADD时指定，之后的EPOLL_CTL_MOD会返回EINVAL，
+ *    因此带EV_EXCLUSIVE的fd改变兴趣时只能先删除再重新添加。
+ * h) epoll_wait的超时只有毫秒精度。内核支持时使用纳秒精度的epoll_pwait2(linux 5.11+)，
+ *    否则在epoll集合中放入一个timerfd，超时不是整毫秒时由它在精确的时刻唤醒我们。
  *
  * 本文件中大量"怪异代码"和复杂处理逻辑，都是为了应对epoll的这些设计缺陷。
  * 我们极力避免在常见使用模式中调用epoll_ctl系统调用，并妥善处理因接收已关闭
@@ -18,9 +22,29 @@
  */
 
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
 
 #define EV_EMASK_EPERM 0x80
 
+/* linux 4.5+, older headers lack it, older kernels ignore it */
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE (1U << 28)
+#endif
+
+/* EPIOCSPARAMS(linux 6.9+)，自行定义以免依赖新的头文件 */
+struct ev_epoll_params
+{
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t pad;
+};
+
+#define EV_EPIOCSPARAMS _IOW(0x8A, 0x01, struct ev_epoll_params)
+
+/* epoll集合中timerfd的user data，不会与fd/代计数器的组合冲突 */
+#define EV_EPOLL_TIMERFD ((uint64_t)-1)
+
 /*
  * 修改文件描述符的epoll监控事件
  * @param loop 事件循环实例
@@ -37,6 +61,8 @@ static void epoll_modify(struct ev_loop *loop, int fd, int oev, int nev)
 {
     struct epoll_event ev;
     unsigned char oldmask;
+    unsigned char kmask;
+    int rearm;
     /*
      * 我们通过在此处忽略EPOLL_CTL_DEL来处理它
      * 基于假设fd无论如何已经消失
@@ -45,10 +71,28 @@ static void epoll_modify(struct ev_loop *loop, int fd, int oev, int nev)
      * 我们假设它仍然具有相同的事件掩码
      */
     if (!nev)
+    {
+        /*
+         * 独占注册不能延迟删除：内核可能把唯一的一次唤醒交给这个已不再关心该fd的循环，
+         * 其他循环则不会被唤醒
+         */
+        if (expect_false(anfds[fd].emask & EV_EXCLUSIVE))
+        {
+            epoll_ctl(backend_fd, EPOLL_CTL_DEL, fd, &ev);
+            anfds[fd].emask = 0;
+        }
+
         return;
+    }
+
+    /*
+     * 边沿触发的fd总是注册双向兴趣，之后兴趣的变化不再需要EPOLL_CTL_MOD，
+     * 多余方向的事件由fd_event按监视器的events过滤
+     */
+    kmask = nev & EV_ET ? (EV_READ | EV_WRITE | EV_ET | (nev & EV_EXCLUSIVE)) : nev;
 
     oldmask = anfds[fd].emask;
-    anfds[fd].emask = nev;
+    anfds[fd].emask = kmask;
 
     /*
      * 存储生成计数器在高32位，fd在低32位
@@ -57,9 +101,22 @@ static void epoll_modify(struct ev_loop *loop, int fd, int oev, int nev)
      * - 可以识别来自其他进程的虚假事件
      */
     ev.data.u64 = (uint64_t)(uint32_t)fd | ((uint64_t)(uint32_t)++anfds[fd].egen << 32);
-    ev.events = (nev & EV_READ ? EPOLLIN : 0) | (nev & EV_WRITE ? EPOLLOUT : 0);
+    ev.events = (kmask & EV_READ ? EPOLLIN : 0) | (kmask & EV_WRITE ? EPOLLOUT : 0) | (kmask & EV_ET ? EPOLLET : 0) | (kmask & EV_EXCLUSIVE ? EPOLLEXCLUSIVE : 0);
+
+    /*
+     * 边沿触发的fd即使掩码不变也要重新注册：fd_reify只在新增方向时调用到这里，
+     * MOD会让内核重新检查就绪状态，补上此前被fd_event丢弃的边沿
+     */
+    rearm = oev && oldmask == kmask && kmask & EV_ET;
+
+    /* 独占注册无法MOD，先删除，下面改为ADD */
+    if (expect_false((oldmask | kmask) & EV_EXCLUSIVE) && oev && (oldmask != kmask || rearm))
+    {
+        epoll_ctl(backend_fd, EPOLL_CTL_DEL, fd, &ev);
+        oev = 0;
+    }
 
-    if (expect_true(!epoll_ctl(backend_fd, oev && oldmask != nev ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev)))
+    if (expect_true(!epoll_ctl(backend_fd, oev && (oldmask != kmask || rearm) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev)))
         return;
 
     if (expect_true(errno == ENOENT))
@@ -75,10 +132,18 @@ static void epoll_modify(struct ev_loop *loop, int fd, int oev, int nev)
     {
         /* EEXIST表示我们忽略了之前的DEL操作，但fd仍然活跃 */
         /* 如果内核掩码与新掩码相同，我们假设它没有改变 */
-        if (oldmask == nev)
+        /* 边沿触发的fd仍要重新注册，没有监视器期间的边沿已被丢弃 */
+        if (oldmask == kmask && !(kmask & EV_ET))
             goto dec_egen;
 
-        if (!epoll_ctl(backend_fd, EPOLL_CTL_MOD, fd, &ev))
+        if (expect_false((oldmask | kmask) & EV_EXCLUSIVE))
+        {
+            epoll_ctl(backend_fd, EPOLL_CTL_DEL, fd, &ev);
+
+            if (!epoll_ctl(backend_fd, EPOLL_CTL_ADD, fd, &ev))
+                return;
+        }
+        else if (!epoll_ctl(backend_fd, EPOLL_CTL_MOD, fd, &ev))
             return;
     }
     else if (expect_true(errno == EPERM))
@@ -123,11 +188,59 @@ static void epoll_poll(struct ev_loop *loop, ev_tstamp timeout)
     if (epoll_epermcnt) [[unlikely]]
         timeout = 0.;
 
-    /* epoll wait times cannot be larger than (LONG_MAX - 999UL) / HZ msecs, which is below */
-    /* the default libev max wait time, however. */
-    EV_RELEASE_CB;
-    eventcnt = epoll_wait(backend_fd, epoll_events, epoll_eventmax, timeout * 1e3);
-    EV_ACQUIRE_CB;
+#ifdef SYS_epoll_pwait2
+    if (epoll_have_pwait2)
+    {
+        struct timespec ts;
+
+        EV_TS_SET(ts, timeout);
+
+        EV_RELEASE_CB;
+        eventcnt = syscall(SYS_epoll_pwait2, backend_fd, epoll_events, epoll_eventmax, &ts, 0, 0);
+        EV_ACQUIRE_CB;
+    }
+    else
+#endif
+    {
+        /* epoll wait times cannot be larger than (LONG_MAX - 999UL) / HZ msecs, which is below */
+        /* the default libev max wait time, however. */
+        int ms = timeout * 1e3;
+#if EV_USE_TIMERFD
+        int armed = 0;
+
+        /* 不是整毫秒：向上取整等待，由timerfd在精确的时刻提前唤醒 */
+        if (epoll_timerfd >= 0 && ms != timeout * 1e3)
+        {
+            struct itimerspec its = {};
+
+            EV_TS_SET(its.it_value, timeout);
+            timerfd_settime(epoll_timerfd, 0, &its, 0);
+            armed = 1;
+            ++ms;
+        }
+#endif
+
+        EV_RELEASE_CB;
+        eventcnt = epoll_wait(backend_fd, epoll_events, epoll_eventmax, ms);
+        EV_ACQUIRE_CB;
+
+#if EV_USE_TIMERFD
+        /* 被I/O或信号提前唤醒时撤销timerfd，否则它会提前结束之后无关的一次等待 */
+        if (armed)
+        {
+            for (i = eventcnt; i-- > 0;)
+                if (epoll_events[i].data.u64 == EV_EPOLL_TIMERFD)
+                    break;
+
+            if (i < 0)
+            {
+                struct itimerspec its = {};
+
+                timerfd_settime(epoll_timerfd, 0, &its, 0);
+            }
+        }
+#endif
+    }
 
     if (eventcnt < 0) [[unlikely]]
     {
@@ -141,6 +254,10 @@ static void epoll_poll(struct ev_loop *loop, ev_tstamp timeout)
     {
         struct epoll_event *ev = epoll_events + i;
 
+        /* timerfd只负责唤醒，它以边沿触发注册，不需要读取 */
+        if (expect_false(ev->data.u64 == EV_EPOLL_TIMERFD))
+            continue;
+
         int fd = (uint32_t)ev->data.u64; /* mask out the lower 32 bits */
         int want = anfds[fd].events;
         int got = (ev->events & (EPOLLOUT | EPOLLERR | EPOLLHUP) ? EV_WRITE : 0) | (ev->events & (EPOLLIN | EPOLLERR | EPOLLHUP) ? EV_READ : 0);
@@ -158,7 +275,11 @@ static void epoll_poll(struct ev_loop *loop, ev_tstamp timeout)
             continue;
         }
 
-        if (expect_false(got & ~want))
+        /*
+         * 边沿触发的fd只要还有监视器，多余的事件不会重复出现；独占注册的fd无法MOD。
+         * 两者都直接交给fd_event过滤，没有监视器时仍然删除
+         */
+        if (expect_false(got & ~want) && !(want & (EV_ET | EV_EXCLUSIVE)))
         {
             anfds[fd].emask = want;
 
@@ -207,6 +328,55 @@ static void epoll_poll(struct ev_loop *loop, ev_tstamp timeout)
     }
 }
 
+/*
+ * 把循环的忙轮询预算交给内核
+ * @param loop 事件循环实例
+ *
+ * 内核在epoll_wait中对该epoll集合里的socket所属的网卡队列忙轮询，
+ * 不支持的内核返回ENOTTY，我们忽略它，用户态的忙轮询照常进行。
+ */
+static void epoll_busy_poll_params(struct ev_loop *loop)
+{
+    struct ev_epoll_params params = {};
+
+    params.busy_poll_usecs = busy_poll < 1. ? (uint32_t)(busy_poll * 1e6) : 1000000;
+    params.busy_poll_budget = params.busy_poll_usecs ? 8 : 0; /* BUSY_POLL_BUDGET, 超过64需要CAP_NET_ADMIN */
+
+    ioctl(backend_fd, EV_EPIOCSPARAMS, &params);
+}
+
+/*
+ * 在没有epoll_pwait2时创建用于亚毫秒唤醒的timerfd并加入epoll集合
+ * @param loop 事件循环实例
+ *
+ * 失败时epoll_timerfd为-1，epoll_poll退回毫秒精度。
+ */
+static void epoll_timerfd_init(struct ev_loop *loop)
+{
+    epoll_timerfd = -1;
+
+#if EV_USE_TIMERFD
+    if (epoll_have_pwait2)
+        return;
+
+    epoll_timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    if (epoll_timerfd >= 0)
+    {
+        struct epoll_event ev;
+
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u64 = EV_EPOLL_TIMERFD;
+
+        if (epoll_ctl(backend_fd, EPOLL_CTL_ADD, epoll_timerfd, &ev))
+        {
+            close(epoll_timerfd);
+            epoll_timerfd = -1;
+        }
+    }
+#endif
+}
+
 /*
  * 初始化epoll后端
  * @param loop 事件循环实例
@@ -233,13 +403,28 @@ int static inline epoll_init(struct ev_loop *loop, int flags)
 
     fcntl(backend_fd, F_SETFD, FD_CLOEXEC);
 
-    backend_mintime = 1e-3; /* epoll does sometimes return early, this is just to avoid the worst */
     backend_modify = epoll_modify;
     backend_poll = epoll_poll;
 
     epoll_eventmax = 64; /* initial number of events receivable per poll */
     epoll_events = (struct epoll_event *)ev_malloc(sizeof(struct epoll_event) * epoll_eventmax);
 
+    epoll_have_pwait2 = 0;
+#ifdef SYS_epoll_pwait2
+    {
+        /* 探测内核支持，旧内核返回ENOSYS，被seccomp禁止时返回EPERM */
+        struct timespec ts = { 0, 0 };
+
+        epoll_have_pwait2 = syscall(SYS_epoll_pwait2, backend_fd, epoll_events, epoll_eventmax, &ts, 0, 0) >= 0;
+    }
+#endif
+    epoll_timerfd_init(loop);
+
+    if (epoll_have_pwait2 || epoll_timerfd >= 0)
+        backend_mintime = 1e-6; /* 纳秒精度的等待，微秒级的误差足够 */
+    else
+        backend_mintime = 1e-3; /* epoll does sometimes return early, this is just to avoid the worst */
+
     return EVBACKEND_EPOLL;
 }
 
@@ -253,6 +438,9 @@ void static inline epoll_destroy(struct ev_loop *loop)
 {
     ev_free(epoll_events);
     array_free(epoll_eperm, EMPTY);
+
+    if (epoll_timerfd >= 0)
+        close(epoll_timerfd);
 }
 
 /*
@@ -273,5 +461,14 @@ void static inline epoll_fork(struct ev_loop *loop)
 
     fcntl(backend_fd, F_SETFD, FD_CLOEXEC);
 
+    /* timerfd与父进程共享，必须重新创建 */
+    if (epoll_timerfd >= 0)
+        close(epoll_timerfd);
+
+    epoll_timerfd_init(loop);
+
+    if (busy_poll)
+        epoll_busy_poll_params(loop);
+
     fd_rearm_all(loop);
 }
@@ -0,0 +1,625 @@
+/*
+ * 关于io_uring后端的总体说明：
+ *
+ * a) 这里只把io_uring当作就绪通知机制使用(IORING_OP_POLL_ADD)，不做真正的异步I/O，
+ *    因此它可以直接替代epoll，而不需要改变libev的任何语义。
+ * b) 与epoll不同，注册/注销请求只是写入共享内存中的提交队列(SQ)。一次fd_reify产生的
+ *    全部变更和随后的等待，会在同一次io_uring_enter中交给内核，而不是每个fd一次epoll_ctl。
+ * c) POLL_ADD是一次性的：事件到达后请求即被内核移除，我们在下一次迭代中重新武装它。
+ *    重新武装同样只是写入SQ，并和等待合并为一个系统调用。
+ *    多次触发(multishot)的POLL_ADD只在唤醒时产生事件，相当于边沿触发，
+ *    不能用来实现ev_io的水平触发语义，因此只用于全部监视器都请求了EV_ET的fd(linux 5.13+)。
+ * d) 为了不依赖liburing和较新的内核头文件，这里自行定义了需要的内核ABI结构。
+ * e) 当内核不支持或拒绝建立ring时(例如被安全策略禁用)，iouring_init返回0，
+ *    loop_init会继续尝试后面的后端(epoll等)。
+ */
+
+#include <sys/mman.h>
+#include <poll.h>
+#include <stdint.h>
+
+/* 内核ABI定义，摘自linux/io_uring.h */
+struct io_uring_sqe
+{
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t ioprio;
+    int32_t fd;
+    union
+    {
+        uint64_t off;
+        uint64_t addr2;
+    };
+    uint64_t addr;
+    uint32_t len;
+    union
+    {
+        uint32_t rw_flags;
+        uint32_t fsync_flags;
+        uint16_t poll_events;
+        uint32_t poll32_events;
+        uint32_t timeout_flags;
+    };
+    uint64_t user_data;
+    union
+    {
+        uint16_t buf_index;
+        uint64_t pad2[3];
+    };
+};
+
+struct io_uring_cqe
+{
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+};
+
+struct io_sqring_offsets
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t array;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct io_cqring_offsets
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t overflow;
+    uint32_t cqes;
+    uint64_t resv[2];
+};
+
+struct io_uring_params
+{
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t flags;
+    uint32_t sq_thread_cpu;
+    uint32_t sq_thread_idle;
+    uint32_t features;
+    uint32_t resv[4];
+    struct io_sqring_offsets sq_off;
+    struct io_cqring_offsets cq_off;
+};
+
+struct io_uring_getevents_arg
+{
+    uint64_t sigmask;
+    uint32_t sigmask_sz;
+    uint32_t pad;
+    uint64_t ts;
+};
+
+struct iouring_timespec
+{
+    int64_t tv_sec;
+    long long tv_nsec;
+};
+
+#define IORING_OFF_SQ_RING 0x00000000ULL
+#define IORING_OFF_CQ_RING 0x08000000ULL
+#define IORING_OFF_SQES 0x10000000ULL
+
+#define IORING_SETUP_CQSIZE (1U << 3)
+
+#define IORING_FEAT_SINGLE_MMAP (1U << 0)
+#define IORING_FEAT_NODROP (1U << 1)
+#define IORING_FEAT_EXT_ARG (1U << 8)
+
+#define IORING_ENTER_GETEVENTS (1U << 0)
+#define IORING_ENTER_EXT_ARG (1U << 3)
+
+#define IORING_SQ_CQ_OVERFLOW (1U << 1)
+
+#define IORING_OP_POLL_ADD 6
+#define IORING_OP_POLL_REMOVE 7
+#define IORING_OP_TIMEOUT 11
+#define IORING_OP_TIMEOUT_REMOVE 12
+
+#define IORING_POLL_ADD_MULTI (1U << 0)
+#define IORING_CQE_F_MORE (1U << 1)
+
+/* 提交队列条目数，完成队列取其8倍，以容纳一次等待中大量fd同时就绪的情况 */
+#define EV_IOURING_ENTRIES 256
+#define EV_IOURING_CQ_FACTOR 8
+
+/* 特殊的user_data：不关心结果的请求，以及我们自己的超时请求 */
+#define EV_IOURING_IGNORE ((uint64_t)-1)
+#define EV_IOURING_TIMEOUT ((uint64_t)-2)
+
+/* 访问共享内存中内核维护的环字段 */
+#define EV_SQ_VAR(name) (*(volatile unsigned *)(iouring_sq_ring + iouring_sq_##name))
+#define EV_CQ_VAR(name) (*(volatile unsigned *)(iouring_cq_ring + iouring_cq_##name))
+#define EV_SQ_ARRAY ((unsigned *)(iouring_sq_ring + iouring_sq_array))
+#define EV_CQES ((struct io_uring_cqe *)(iouring_cq_ring + iouring_cq_cqes))
+
+static int evsys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return syscall(SYS_io_uring_setup, entries, params);
+}
+
+static int evsys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t argsz)
+{
+    return syscall(SYS_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+/* 与epoll相同：低32位存放fd，高32位存放代计数器 */
+static inline uint64_t iouring_userdata(int fd, unsigned int gen)
+{
+    return (uint64_t)(uint32_t)fd | ((uint64_t)(uint32_t)gen << 32);
+}
+
+/*
+ * 把已写入提交队列的请求交给内核，并在需要时等待完成事件
+ * @param loop 事件循环实例
+ * @param timeout 最大等待时间(秒)，为0时只提交不等待
+ * @return io_uring_enter的返回值
+ *
+ * 这是本后端唯一的系统调用入口：一次迭代中的全部注册变更、
+ * 超时设置以及等待都在这里合并为一次io_uring_enter。
+ */
+static int iouring_enter(struct ev_loop *loop, ev_tstamp timeout);
+static int iouring_handle_cq(struct ev_loop *loop);
+
+/*
+ * 获取一个空闲的提交队列条目
+ * @param loop 事件循环实例
+ * @return 已清零的sqe，调用者填写后需调用iouring_sqe_submit
+ *
+ * 提交队列已满时先把已有的请求提交给内核(不等待)，这只会在
+ * 单次迭代的变更数超过队列长度时发生。
+ */
+static struct io_uring_sqe *iouring_sqe_get(struct ev_loop *loop)
+{
+    unsigned tail;
+    struct io_uring_sqe *sqe;
+
+    for (;;)
+    {
+        tail = EV_SQ_VAR(tail) + iouring_to_submit;
+
+        if (expect_true(tail - EV_SQ_VAR(head) < EV_SQ_VAR(ring_entries)))
+            break;
+
+        if (iouring_enter(loop, 0.) < 0)
+        {
+            /* 内核积压了完成事件，拒绝接收新的请求：先处理完成队列 */
+            if (errno == EBUSY || errno == EAGAIN)
+                iouring_handle_cq(loop);
+            else if (errno != EINTR)
+                ev_syserr("(libev) io_uring_enter");
+        }
+    }
+
+    sqe = iouring_sqes + (tail & EV_SQ_VAR(ring_mask));
+    memset(sqe, 0, sizeof(*sqe));
+
+    return sqe;
+}
+
+/* sqe已填写完毕，它会在下一次iouring_enter时提交 */
+static inline void iouring_sqe_submit(struct ev_loop *loop, struct io_uring_sqe *sqe)
+{
+    ++iouring_to_submit;
+}
+
+/*
+ * 修改文件描述符的监控事件
+ * @param loop 事件循环实例
+ * @param fd 要修改的文件描述符
+ * @param oev 原事件掩码
+ * @param nev 新事件掩码
+ *
+ * 只向提交队列写入POLL_REMOVE/POLL_ADD请求，不进入内核。
+ */
+static void iouring_modify(struct ev_loop *loop, int fd, int oev, int nev)
+{
+    struct io_uring_sqe *sqe;
+
+    if (oev)
+    {
+        /* 内核通过提交时的user_data找到要移除的请求，失败(例如请求已经完成)也无妨 */
+        sqe = iouring_sqe_get(loop);
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = iouring_userdata(fd, anfds[fd].egen);
+        sqe->user_data = EV_IOURING_IGNORE;
+        iouring_sqe_submit(loop, sqe);
+
+        /* 递增代计数器，丢弃旧请求可能仍会产生的完成事件 */
+        ++anfds[fd].egen;
+    }
+
+    anfds[fd].emask = 0;
+
+    if (nev)
+    {
+        sqe = iouring_sqe_get(loop);
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->user_data = iouring_userdata(fd, anfds[fd].egen);
+
+        /*
+         * 边沿触发的fd使用多次触发的poll请求并注册双向兴趣，
+         * 请求在每次就绪后保持有效，兴趣变化也不必重新提交
+         */
+        if (nev & EV_ET && iouring_multishot)
+        {
+            anfds[fd].emask = EV_READ | EV_WRITE | EV_ET;
+            sqe->len = IORING_POLL_ADD_MULTI;
+            nev |= EV_READ | EV_WRITE;
+        }
+
+        sqe->poll_events = (nev & EV_READ ? POLLIN : 0) | (nev & EV_WRITE ? POLLOUT : 0);
+        iouring_sqe_submit(loop, sqe);
+    }
+}
+
+/*
+ * 批量修改文件描述符的监控事件
+ * @param loop 事件循环实例
+ * @param mods fd_reify收集的变更数组
+ * @param cnt 变更数量
+ *
+ * 变更只写入提交队列，并和随后的等待合并为一次io_uring_enter。
+ * 这里省去了每个fd一次的间接调用，anfds项已由fd_reify预取。
+ */
+static void iouring_modify_batch(struct ev_loop *loop, const ANFDMOD *mods, int cnt)
+{
+    int i;
+
+    for (i = 0; i < cnt; ++i)
+        iouring_modify(loop, mods[i].fd, mods[i].oev, mods[i].nev);
+}
+
+static int iouring_enter(struct ev_loop *loop, ev_tstamp timeout)
+{
+    int res;
+    unsigned to_submit;
+    unsigned min_complete = 0;
+    unsigned flags = 0;
+    const void *arg = 0;
+    size_t argsz = 0;
+    struct iouring_timespec ts;
+    struct io_uring_getevents_arg ext;
+
+    if (timeout)
+    {
+        EV_TS_SET(ts, timeout);
+        flags |= IORING_ENTER_GETEVENTS;
+        min_complete = 1;
+
+        if (iouring_ext_arg)
+        {
+            /* 5.11及更新的内核可以直接把超时交给io_uring_enter */
+            memset(&ext, 0, sizeof(ext));
+            ext.ts = (uint64_t)(uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            arg = &ext;
+            argsz = sizeof(ext);
+        }
+        else
+        {
+            struct io_uring_sqe *sqe;
+
+            /* 旧内核：先撤销上一次未触发的超时请求，再提交新的超时请求 */
+            /* 两者与其他请求按顺序在同一次系统调用中处理 */
+            if (iouring_timeouts)
+            {
+                sqe = iouring_sqe_get(loop);
+                sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+                sqe->fd = -1;
+                sqe->addr = EV_IOURING_TIMEOUT;
+                sqe->user_data = EV_IOURING_IGNORE;
+                iouring_sqe_submit(loop, sqe);
+            }
+
+            sqe = iouring_sqe_get(loop);
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = (uint64_t)(uintptr_t)&ts; /* 内核在提交时复制ts */
+            sqe->len = 1;
+            sqe->user_data = EV_IOURING_TIMEOUT;
+            iouring_sqe_submit(loop, sqe);
+
+            ++iouring_timeouts;
+        }
+    }
+    else if (EV_SQ_VAR(flags) & IORING_SQ_CQ_OVERFLOW)
+        /* 内核中积压了溢出的完成事件，需要GETEVENTS把它们刷到完成队列 */
+        flags |= IORING_ENTER_GETEVENTS;
+
+    /* 发布所有新写入的sqe，内核只在io_uring_enter中读取队列尾 */
+    /* 上一次因EBUSY等原因未被内核取走的sqe也一并提交 */
+    ECB_MEMORY_FENCE_RELEASE;
+    EV_SQ_VAR(tail) = EV_SQ_VAR(tail) + iouring_to_submit;
+    iouring_to_submit = 0;
+    to_submit = EV_SQ_VAR(tail) - EV_SQ_VAR(head);
+
+    if (timeout)
+        EV_RELEASE_CB;
+
+    res = evsys_io_uring_enter(backend_fd, to_submit, min_complete, flags, arg, argsz);
+
+    if (timeout)
+        EV_ACQUIRE_CB;
+
+    return res;
+}
+
+/*
+ * 处理一个完成事件
+ * @param loop 事件循环实例
+ * @param cqe 完成队列条目
+ */
+static void iouring_process_cqe(struct ev_loop *loop, struct io_uring_cqe *cqe)
+{
+    int fd = cqe->user_data & 0xffffffffU;
+    uint32_t gen = cqe->user_data >> 32;
+    int res = cqe->res;
+
+    /* POLL_REMOVE/TIMEOUT_REMOVE的结果我们并不关心 */
+    if (cqe->user_data == EV_IOURING_IGNORE)
+        return;
+
+    /* 超时请求到期(-ETIME)或被撤销(-ECANCELED) */
+    if (cqe->user_data == EV_IOURING_TIMEOUT)
+    {
+        --iouring_timeouts;
+        return;
+    }
+
+    assert(("libev: io_uring fd must be in-bounds", fd >= 0 && fd < anfdmax));
+
+    /* 代计数器不匹配说明这是已被替换或移除的旧请求 */
+    if (expect_false(gen != (uint32_t)anfds[fd].egen))
+        return;
+
+    /* 与文档不同，res和原始系统调用一样返回负的错误码 */
+    if (expect_false(res < 0))
+    {
+        if (res == -EBADF)
+            fd_kill(loop, fd);
+        else
+        {
+            errno = -res;
+            ev_syserr("(libev) IORING_OP_POLL_ADD");
+        }
+
+        return;
+    }
+
+    fd_event(loop, fd, (res & (POLLOUT | POLLERR | POLLHUP) ? EV_WRITE : 0) | (res & (POLLIN | POLLERR | POLLHUP) ? EV_READ : 0));
+
+    /* 多次触发的请求仍然有效 */
+    if (cqe->flags & IORING_CQE_F_MORE)
+        return;
+
+    /* 请求是一次性的(或多次触发的请求被内核终止)，已被内核移除，在下一次迭代中重新武装 */
+    anfds[fd].events = 0;
+    fd_change(loop, fd, EV_ANFD_REIFY);
+}
+
+/*
+ * 处理完成队列中的全部事件，不需要系统调用
+ * @param loop 事件循环实例
+ * @return 处理了事件返回1，队列为空返回0
+ */
+static int iouring_handle_cq(struct ev_loop *loop)
+{
+    unsigned head, tail, mask;
+
+    head = EV_CQ_VAR(head);
+    tail = EV_CQ_VAR(tail);
+    ECB_MEMORY_FENCE_ACQUIRE;
+
+    if (head == tail)
+        return 0;
+
+    mask = EV_CQ_VAR(ring_mask);
+
+    do
+        iouring_process_cqe(loop, &EV_CQES[head++ & mask]);
+    while (head != tail);
+
+    ECB_MEMORY_FENCE_RELEASE;
+    EV_CQ_VAR(head) = head;
+
+    return 1;
+}
+
+/*
+ * 提交变更、等待并处理就绪事件
+ * @param loop 事件循环实例
+ * @param timeout 最大等待时间(秒)
+ */
+static void iouring_poll(struct ev_loop *loop, ev_tstamp timeout)
+{
+    /* 完成队列中已有事件，或者有需要重新武装的fd时，不再等待 */
+    if (iouring_handle_cq(loop) || fdchangecnt)
+        timeout = 0.;
+
+    if (timeout || iouring_to_submit || EV_SQ_VAR(tail) != EV_SQ_VAR(head) || (EV_SQ_VAR(flags) & IORING_SQ_CQ_OVERFLOW))
+    {
+        int res = iouring_enter(loop, timeout);
+
+        /* EBUSY/EAGAIN: 内核的完成事件积压，处理完成队列后下次再提交 */
+        if (expect_false(res < 0) && errno != EINTR && errno != ETIME && errno != EBUSY && errno != EAGAIN)
+            ev_syserr("(libev) io_uring_enter");
+
+        iouring_handle_cq(loop);
+    }
+}
+
+/*
+ * 释放ring的共享内存映射，不关闭backend_fd
+ * @param loop 事件循环实例
+ */
+static void iouring_internal_destroy(struct ev_loop *loop)
+{
+    if (iouring_sq_ring)
+        munmap(iouring_sq_ring, iouring_sq_ring_size);
+    if (iouring_cq_ring && iouring_cq_ring != iouring_sq_ring)
+        munmap(iouring_cq_ring, iouring_cq_ring_size);
+    if (iouring_sqes)
+        munmap(iouring_sqes, iouring_sqes_size);
+
+    iouring_sq_ring = 0;
+    iouring_cq_ring = 0;
+    iouring_sqes = 0;
+}
+
+/*
+ * 建立ring并映射提交/完成队列
+ * @param loop 事件循环实例
+ * @return 成功返回0，失败返回-1(已映射的部分由iouring_internal_destroy释放)
+ */
+static int iouring_internal_init(struct ev_loop *loop)
+{
+    struct io_uring_params params;
+    unsigned i;
+    void *ptr;
+
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = EV_IOURING_ENTRIES * EV_IOURING_CQ_FACTOR;
+
+    iouring_to_submit = 0;
+    iouring_timeouts = 0;
+
+    backend_fd = evsys_io_uring_setup(EV_IOURING_ENTRIES, &params);
+
+    if (backend_fd < 0)
+        return -1;
+
+    /* 没有NODROP时完成事件可能被丢弃，我们无法可靠地重新武装 */
+    if (!(params.features & IORING_FEAT_NODROP))
+        return -1;
+
+    iouring_sq_head = params.sq_off.head;
+    iouring_sq_tail = params.sq_off.tail;
+    iouring_sq_ring_mask = params.sq_off.ring_mask;
+    iouring_sq_ring_entries = params.sq_off.ring_entries;
+    iouring_sq_flags = params.sq_off.flags;
+    iouring_sq_array = params.sq_off.array;
+
+    iouring_cq_head = params.cq_off.head;
+    iouring_cq_tail = params.cq_off.tail;
+    iouring_cq_ring_mask = params.cq_off.ring_mask;
+    iouring_cq_cqes = params.cq_off.cqes;
+
+    iouring_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    iouring_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    iouring_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (iouring_cq_ring_size > iouring_sq_ring_size)
+            iouring_sq_ring_size = iouring_cq_ring_size;
+    }
+
+    ptr = mmap(0, iouring_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend_fd, IORING_OFF_SQ_RING);
+    if (ptr == MAP_FAILED)
+        return -1;
+    iouring_sq_ring = (char *)ptr;
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+        iouring_cq_ring = iouring_sq_ring;
+    else
+    {
+        ptr = mmap(0, iouring_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend_fd, IORING_OFF_CQ_RING);
+        if (ptr == MAP_FAILED)
+            return -1;
+        iouring_cq_ring = (char *)ptr;
+    }
+
+    ptr = mmap(0, iouring_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, backend_fd, IORING_OFF_SQES);
+    if (ptr == MAP_FAILED)
+        return -1;
+    iouring_sqes = (struct io_uring_sqe *)ptr;
+
+    /* 提交队列数组采用恒等映射，sqe在iouring_sqes中的下标就是它在队列中的位置 */
+    for (i = 0; i < params.sq_entries; ++i)
+        EV_SQ_ARRAY[i] = i;
+
+    iouring_ext_arg = !!(params.features & IORING_FEAT_EXT_ARG);
+    iouring_multishot = ev_linux_version() >= 0x050d00; /* IORING_POLL_ADD_MULTI */
+
+    return 0;
+}
+
+/*
+ * 初始化io_uring后端
+ * @param loop 事件循环实例
+ * @param flags 初始化标志
+ * @return 成功返回EVBACKEND_IOURING，失败返回0
+ *
+ * 内核不支持io_uring(ENOSYS)、被策略禁用(EPERM)或功能不足时返回0，
+ * 由loop_init继续尝试其他后端。io_uring的fd由内核创建时已带有O_CLOEXEC。
+ */
+int static inline iouring_init(struct ev_loop *loop, int flags)
+{
+    if (iouring_internal_init(loop) < 0)
+    {
+        iouring_internal_destroy(loop);
+
+        if (backend_fd >= 0)
+            close(backend_fd);
+
+        backend_fd = -1;
+        return 0;
+    }
+
+    backend_mintime = 1e-6; /* 超时使用纳秒精度的timespec */
+    backend_modify = iouring_modify;
+    backend_modify_batch = iouring_modify_batch;
+    backend_poll = iouring_poll;
+
+    return EVBACKEND_IOURING;
+}
+
+/*
+ * 销毁io_uring后端资源
+ * @param loop 事件循环实例
+ *
+ * backend_fd由ev_loop_destroy关闭，这里只解除映射
+ */
+void static inline iouring_destroy(struct ev_loop *loop)
+{
+    iouring_internal_destroy(loop);
+}
+
+/*
+ * 处理fork后的io_uring状态重建
+ * @param loop 事件循环实例
+ *
+ * ring的映射与父进程共享，子进程不能再写入它，只能解除映射并建立新的ring，
+ * 然后重新注册所有文件描述符。
+ */
+void static inline iouring_fork(struct ev_loop *loop)
+{
+    iouring_internal_destroy(loop);
+    close(backend_fd);
+
+    while (iouring_internal_init(loop) < 0)
+    {
+        iouring_internal_destroy(loop);
+
+        if (backend_fd >= 0)
+            close(backend_fd);
+
+        ev_syserr("(libev) io_uring_setup");
+    }
+
+    fd_rearm_all(loop);
+}
@@ -93,11 +93,31 @@ static void kqueue_modify(struct ev_loop *loop, int fd, int oev, int nev)
     /* to detect close/reopen reliably, we have to re-add */
     /* event requests even when oev == nev */
 
+    /* EV_ET直接映射为EV_CLEAR，由kqueue为每个过滤器单独实现边沿触发 */
     if (nev & EV_READ)
-        kqueue_change(loop, fd, EVFILT_READ, EV_ADD | EV_ENABLE, NOTE_EOF);
+        kqueue_change(loop, fd, EVFILT_READ, EV_ADD | EV_ENABLE | (nev & EV_ET ? EV_CLEAR : 0), NOTE_EOF);
 
     if (nev & EV_WRITE)
-        kqueue_change(loop, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE, NOTE_EOF);
+        kqueue_change(loop, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE | (nev & EV_ET ? EV_CLEAR : 0), NOTE_EOF);
+}
+
+/*
+ * 批量修改文件描述符的kqueue监控事件
+ * @param loop 事件循环实例
+ * @param mods fd_reify收集的变更数组
+ * @param cnt 变更数量
+ *
+ * 每项变更最多产生两个删除和两个添加请求，这里一次性把更改队列扩充到足够大，
+ * 之后逐项追加时不再需要重新分配。
+ */
+static void kqueue_modify_batch(struct ev_loop *loop, const ANFDMOD *mods, int cnt)
+{
+    int i;
+
+    array_needsize(struct kevent, kqueue_changes, kqueue_changemax, kqueue_changecnt + cnt * 4, EMPTY2);
+
+    for (i = 0; i < cnt; ++i)
+        kqueue_modify(loop, mods[i].fd, mods[i].oev, mods[i].nev);
 }
 
 /*
@@ -209,6 +229,7 @@ int static inline kqueue_init(struct ev_loop *loop, int flags)
 
     backend_mintime = 1e-9; /* apparently, they did the right thing in freebsd */
     backend_modify = kqueue_modify;
+    backend_modify_batch = kqueue_modify_batch;
     backend_poll = kqueue_poll;
 
     kqueue_eventmax = 64; /* initial number of events receivable per poll */
@@ -0,0 +1,538 @@
+/*
+ * 关于Linux AIO后端的总体说明：
+ *
+ * a) 这里只使用IOCB_CMD_POLL(linux 4.18+，4.19起可靠)，把Linux AIO当作就绪通知机制使用，
+ *    与io_uring后端一样不做真正的异步I/O。在io_uring被安全策略禁用的系统上，
+ *    这是唯一能够批量注册、避免每次变更一次epoll_ctl的接口。
+ * b) 注册请求只是放进提交数组，一次迭代的全部变更在等待前用一次io_submit交给内核。
+ * c) POLL请求是一次性的：事件到达后请求即结束，我们在下一次迭代中重新武装它。
+ *    只有请求仍在内核中时才需要io_cancel撤销它，这是唯一需要逐fd系统调用的情况。
+ * d) 完成事件直接从映射到用户空间的AIO环中读取，环中已有事件时不需要系统调用，
+ *    只有环为空且需要等待时才调用io_getevents。
+ * e) 内核拒绝poll的fd(EINVAL)与epoll的EPERM情况一样，视为总是就绪。
+ * f) 同时在内核中的请求数受环大小限制，io_submit返回EAGAIN且环中没有可处理的事件时，
+ *    我们按在途请求数建立一个更大的环并重新注册全部fd。
+ * i) 每个fd的iocb指针存放在anfds的冷数据页中，和anfds一样只为有监视器的页分配，
+ *    很大的fd不会迫使我们分配一个按fd索引的稠密数组。
+ * g) AIO上下文不会被子进程继承，fork后直接建立新的上下文即可。
+ * h) 为了不依赖较新的内核头文件，这里自行定义了需要的内核ABI结构。
+ */
+
+#include <poll.h>
+#include <stdint.h>
+
+/* 内核ABI定义，摘自linux/aio_abi.h */
+typedef unsigned long aio_context_t;
+
+#define IOCB_CMD_POLL 5
+
+struct iocb
+{
+    uint64_t aio_data;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint32_t aio_rw_flags;
+    uint32_t aio_key;
+#else
+    uint32_t aio_key;
+    uint32_t aio_rw_flags;
+#endif
+    uint16_t aio_lio_opcode;
+    int16_t aio_reqprio;
+    uint32_t aio_fildes;
+    uint64_t aio_buf;
+    uint64_t aio_nbytes;
+    int64_t aio_offset;
+    uint64_t aio_reserved2;
+    uint32_t aio_flags;
+    uint32_t aio_resfd;
+};
+
+struct io_event
+{
+    uint64_t data;
+    uint64_t obj;
+    int64_t res;
+    int64_t res2;
+};
+
+/* 内核内部的环头部(fs/aio.c)，io_setup返回的上下文id就是它在用户空间的地址 */
+struct aio_ring
+{
+    unsigned id;
+    unsigned nr;
+    unsigned head;
+    unsigned tail;
+    unsigned magic;
+    unsigned compat_features;
+    unsigned incompat_features;
+    unsigned header_length;
+    struct io_event io_events[0];
+};
+
+#define EV_AIO_RING_MAGIC 0xa10a10a1
+#define EV_AIO_RING_INCOMPAT_FEATURES 0
+
+/* 初始的环大小，请求过多时扩大 */
+#define EV_LINUXAIO_DEPTH 256
+
+/* 每次io_getevents最多取回的事件数，更多的事件直接从环中读取 */
+#define EV_LINUXAIO_GETEVENTS 8
+
+/* 总是就绪的fd在iocb的aio_reqprio中的标记 */
+#define EV_LINUXAIO_ALWAYS_READY -1
+
+static long evsys_io_setup(unsigned nr_events, aio_context_t *ctx_idp)
+{
+    return syscall(SYS_io_setup, nr_events, ctx_idp);
+}
+
+static long evsys_io_destroy(aio_context_t ctx_id)
+{
+    return syscall(SYS_io_destroy, ctx_id);
+}
+
+static long evsys_io_submit(aio_context_t ctx_id, long nr, struct iocb **iocbpp)
+{
+    return syscall(SYS_io_submit, ctx_id, nr, iocbpp);
+}
+
+static long evsys_io_cancel(aio_context_t ctx_id, struct iocb *iocb, struct io_event *result)
+{
+    return syscall(SYS_io_cancel, ctx_id, iocb, result);
+}
+
+static long evsys_io_getevents(aio_context_t ctx_id, long min_nr, long nr, struct io_event *events, struct timespec *timeout)
+{
+    return syscall(SYS_io_getevents, ctx_id, min_nr, nr, events, timeout);
+}
+
+/*
+ * 建立AIO上下文并检查用户空间的环是否可以直接读取
+ * @param loop 事件循环实例
+ * @return 成功返回0，失败返回-1
+ */
+static int linuxaio_io_setup(struct ev_loop *loop)
+{
+    aio_context_t ctx = 0;
+    struct aio_ring *ring;
+
+    if (evsys_io_setup(linuxaio_ringsize, &ctx) < 0)
+        return -1;
+
+    /* 只有在环的格式是我们认识的格式时，才能绕过io_getevents直接读取它 */
+    ring = (struct aio_ring *)ctx;
+
+    if (ring->magic != EV_AIO_RING_MAGIC || ring->incompat_features != EV_AIO_RING_INCOMPAT_FEATURES || ring->header_length != sizeof(struct aio_ring))
+    {
+        evsys_io_destroy(ctx);
+        return -1;
+    }
+
+    linuxaio_ctx = ctx;
+
+    return 0;
+}
+
+/*
+ * 在新的AIO上下文中重新注册全部fd
+ * @param loop 事件循环实例
+ *
+ * 旧上下文中的请求已经不存在，清除所有iocb的"在内核中"和"总是就绪"标记，
+ * 丢弃尚未提交的请求，然后由fd_rearm_all在下一次迭代中重新武装。
+ */
+static void linuxaio_rearm_all(struct ev_loop *loop)
+{
+    int page, i;
+
+    /* 只扫描已分配的页 */
+    for (page = 0; page < anfds.pagemax; ++page)
+        if (anfds.coldpages[page] != anfd_zero_coldpage)
+            for (i = 0; i < (int)EV_ANFD_PAGESIZE; ++i)
+            {
+                struct iocb *iocb = anfds.coldpages[page][i].iocb;
+
+                if (iocb)
+                {
+                    iocb->aio_buf = 0;
+                    iocb->aio_reqprio = 0;
+                }
+            }
+
+    linuxaio_inflight = 0;
+    linuxaio_submitcnt = 0;
+    linuxaio_readycnt = 0;
+
+    fd_rearm_all(loop);
+}
+
+/*
+ * 修改文件描述符的监控事件
+ * @param loop 事件循环实例
+ * @param fd 要修改的文件描述符
+ * @param oev 原事件掩码
+ * @param nev 新事件掩码
+ *
+ * 每个fd有一个地址固定的iocb(io_cancel通过地址找到请求)，aio_buf中存放poll掩码，
+ * 非0表示请求已提交或等待提交。新的请求只放进提交数组，在linuxaio_poll中一起提交。
+ */
+static void linuxaio_modify(struct ev_loop *loop, int fd, int oev, int nev)
+{
+    struct iocb *iocb = anfds.cold(fd).iocb;
+
+    if (expect_false(!iocb))
+    {
+        iocb = (struct iocb *)ev_malloc(sizeof(struct iocb));
+        memset(iocb, 0, sizeof(struct iocb));
+        iocb->aio_lio_opcode = IOCB_CMD_POLL;
+        anfds.cold(fd).iocb = iocb;
+    }
+
+    /* 总是就绪的fd由linuxaio_poll合成事件，没有监视器后从列表中移除 */
+    if (expect_false(iocb->aio_reqprio == EV_LINUXAIO_ALWAYS_READY))
+        return;
+
+    if (iocb->aio_buf)
+    {
+        /* 请求仍在内核中(或已完成但尚未处理)，撤销它，失败也无妨 */
+        struct io_event ev;
+
+        evsys_io_cancel(linuxaio_ctx, iocb, &ev);
+
+        /* 递增代计数器，丢弃旧请求可能仍会产生的完成事件 */
+        ++anfds[fd].egen;
+        --linuxaio_inflight;
+    }
+
+    iocb->aio_buf = (nev & EV_READ ? POLLIN : 0) | (nev & EV_WRITE ? POLLOUT : 0);
+
+    if (iocb->aio_buf)
+    {
+        ++linuxaio_inflight;
+
+        /* 与epoll相同：低32位存放fd，高32位存放代计数器 */
+        iocb->aio_fildes = fd;
+        iocb->aio_data = (uint64_t)(uint32_t)fd | ((uint64_t)(uint32_t)anfds[fd].egen << 32);
+
+        array_needsize(struct iocb *, linuxaio_submits, linuxaio_submitmax, linuxaio_submitcnt + 1, EMPTY2);
+        linuxaio_submits[linuxaio_submitcnt++] = iocb;
+    }
+}
+
+/*
+ * 批量修改文件描述符的监控事件
+ * @param loop 事件循环实例
+ * @param mods fd_reify收集的变更数组
+ * @param cnt 变更数量
+ *
+ * 一次性把提交数组扩充到足够大，之后逐项追加时不再需要重新分配。
+ */
+static void linuxaio_modify_batch(struct ev_loop *loop, const ANFDMOD *mods, int cnt)
+{
+    int i;
+
+    array_needsize(struct iocb *, linuxaio_submits, linuxaio_submitmax, linuxaio_submitcnt + cnt, EMPTY2);
+
+    for (i = 0; i < cnt; ++i)
+        linuxaio_modify(loop, mods[i].fd, mods[i].oev, mods[i].nev);
+}
+
+/*
+ * 处理一组完成事件
+ * @param loop 事件循环实例
+ * @param ev 完成事件数组
+ * @param nr 事件数量
+ */
+static void linuxaio_parse_events(struct ev_loop *loop, struct io_event *ev, int nr)
+{
+    for (; nr; --nr, ++ev)
+    {
+        int fd = ev->data & 0xffffffffU;
+        uint32_t gen = ev->data >> 32;
+        int res = ev->res;
+
+        assert(("libev: linuxaio fd must be in-bounds", fd >= 0 && fd < anfdmax));
+
+        /* 代计数器不匹配说明这是已被撤销或替换的旧请求 */
+        if (expect_false(gen != (uint32_t)anfds[fd].egen))
+            continue;
+
+        /* 请求已经结束，不再在内核中 */
+        anfds.cold(fd).iocb->aio_buf = 0;
+        --linuxaio_inflight;
+
+        if (expect_false(res < 0))
+        {
+            if (res == -EBADF)
+                fd_kill(loop, fd);
+            else
+            {
+                errno = -res;
+                ev_syserr("(libev) IOCB_CMD_POLL");
+            }
+
+            continue;
+        }
+
+        fd_event(loop, fd, (res & (POLLOUT | POLLERR | POLLHUP) ? EV_WRITE : 0) | (res & (POLLIN | POLLERR | POLLHUP) ? EV_READ : 0));
+
+        /* 请求是一次性的，在下一次迭代中重新武装 */
+        anfds[fd].events = 0;
+        fd_change(loop, fd, EV_ANFD_REIFY);
+    }
+}
+
+/*
+ * 直接从用户空间的环中取出全部完成事件，不需要系统调用
+ * @param loop 事件循环实例
+ * @return 处理了事件返回1，环为空返回0
+ *
+ * 只有环为空时我们才调用io_getevents，所以内核不会同时修改head。
+ * 移动head同时也把环中的位置还给内核，io_submit可以继续提交新的请求。
+ */
+static int linuxaio_get_events_from_ring(struct ev_loop *loop)
+{
+    struct aio_ring *ring = (struct aio_ring *)linuxaio_ctx;
+    unsigned head, tail;
+
+    head = *(volatile unsigned *)&ring->head;
+    tail = *(volatile unsigned *)&ring->tail;
+    ECB_MEMORY_FENCE_ACQUIRE;
+
+    if (head == tail)
+        return 0;
+
+    /* 环可能已经回绕 */
+    if (tail > head)
+        linuxaio_parse_events(loop, ring->io_events + head, tail - head);
+    else
+    {
+        linuxaio_parse_events(loop, ring->io_events + head, ring->nr - head);
+        linuxaio_parse_events(loop, ring->io_events, tail);
+    }
+
+    ECB_MEMORY_FENCE_RELEASE;
+    *(volatile unsigned *)&ring->head = tail;
+
+    return 1;
+}
+
+/*
+ * 建立一个更大的环，替换请求数已经达到上限的旧环
+ * @param loop 事件循环实例
+ *
+ * io_destroy要等待一个RCU宽限期(数十毫秒)，所以我们一次就把环扩大到能容纳
+ * 全部在途请求的大小，而不是逐次加倍。按在途请求数而不是最大的fd计算，
+ * 一个很大的fd不会让我们先向io_setup要一个超过aio-max-nr的环。
+ */
+static void linuxaio_grow(struct ev_loop *loop)
+{
+    aio_context_t old = linuxaio_ctx;
+    int oldsize = linuxaio_ringsize;
+
+    do
+        linuxaio_ringsize *= 2;
+    while (linuxaio_ringsize < linuxaio_inflight);
+
+    /* 受aio-max-nr限制，退而求其次只加倍 */
+    if (linuxaio_io_setup(loop) < 0 && (linuxaio_ringsize = oldsize * 2, linuxaio_io_setup(loop) < 0))
+    {
+        linuxaio_ringsize = oldsize;
+        ev_syserr("(libev) linuxaio io_setup");
+        return;
+    }
+
+    /* 撤销旧环中的全部请求 */
+    evsys_io_destroy(old);
+
+    linuxaio_rearm_all(loop);
+}
+
+/*
+ * 把提交数组中的请求交给内核
+ * @param loop 事件循环实例
+ *
+ * io_submit在第一个请求出错时返回错误，之后的请求没有提交，
+ * 我们处理掉出错的请求后继续提交剩下的。
+ */
+static void linuxaio_submit(struct ev_loop *loop)
+{
+    int submitted = 0;
+
+    while (submitted < linuxaio_submitcnt)
+    {
+        long res = evsys_io_submit(linuxaio_ctx, linuxaio_submitcnt - submitted, linuxaio_submits + submitted);
+
+        if (expect_true(res > 0))
+            submitted += res;
+        else if (res < 0 && errno == EAGAIN)
+        {
+            /* 内核中的请求数达到上限：先处理环中的事件让出位置，没有可处理的事件就换一个更大的环 */
+            if (!linuxaio_get_events_from_ring(loop))
+            {
+                linuxaio_grow(loop);
+                return;
+            }
+        }
+        else if (res < 0 && (errno == EINVAL || errno == EBADF))
+        {
+            struct iocb *iocb = linuxaio_submits[submitted++];
+            int fd = iocb->aio_fildes;
+
+            iocb->aio_buf = 0;
+            --linuxaio_inflight;
+
+            if (errno == EBADF)
+                fd_kill(loop, fd);
+            else
+            {
+                /* 不支持poll的fd，和epoll的EPERM一样视为总是就绪 */
+                iocb->aio_reqprio = EV_LINUXAIO_ALWAYS_READY;
+
+                array_needsize(int, linuxaio_readys, linuxaio_readymax, linuxaio_readycnt + 1, EMPTY2);
+                linuxaio_readys[linuxaio_readycnt++] = fd;
+            }
+        }
+        else if (res < 0 && errno == EINTR)
+            /* retry */;
+        else
+        {
+            ev_syserr("(libev) linuxaio io_submit");
+            break;
+        }
+    }
+
+    linuxaio_submitcnt = 0;
+}
+
+/*
+ * 提交变更、等待并处理就绪事件
+ * @param loop 事件循环实例
+ * @param timeout 最大等待时间(秒)
+ */
+static void linuxaio_poll(struct ev_loop *loop, ev_tstamp timeout)
+{
+    int i;
+
+    linuxaio_submit(loop);
+
+    /* 有总是就绪的fd，或者有需要重新武装的fd时，不再等待 */
+    if (linuxaio_readycnt || fdchangecnt)
+        timeout = 0.;
+
+    /* 环中已有事件时不需要系统调用，不等待时也不需要 */
+    if (!linuxaio_get_events_from_ring(loop) && timeout)
+    {
+        struct io_event ioev[EV_LINUXAIO_GETEVENTS];
+        struct timespec ts;
+        long res;
+
+        EV_TS_SET(ts, timeout);
+
+        EV_RELEASE_CB;
+        res = evsys_io_getevents(linuxaio_ctx, 1, EV_LINUXAIO_GETEVENTS, ioev, &ts);
+        EV_ACQUIRE_CB;
+
+        if (expect_false(res < 0))
+        {
+            if (errno != EINTR)
+                ev_syserr("(libev) linuxaio io_getevents");
+        }
+        else if (res)
+        {
+            linuxaio_parse_events(loop, ioev, res);
+
+            /* 缓冲区满了，剩下的事件直接从环中读取 */
+            if (res == EV_LINUXAIO_GETEVENTS)
+                linuxaio_get_events_from_ring(loop);
+        }
+    }
+
+    /* now synthesize events for all fds where poll fails, while select works... */
+    for (i = linuxaio_readycnt; i--;)
+    {
+        int fd = linuxaio_readys[i];
+        unsigned char events = anfds[fd].events & (EV_READ | EV_WRITE);
+
+        if (events)
+            fd_event(loop, fd, events);
+        else
+        {
+            linuxaio_readys[i] = linuxaio_readys[--linuxaio_readycnt];
+            anfds.cold(fd).iocb->aio_reqprio = 0;
+        }
+    }
+}
+
+/*
+ * 初始化Linux AIO后端
+ * @param loop 事件循环实例
+ * @param flags 初始化标志
+ * @return 成功返回EVBACKEND_LINUXAIO，失败返回0
+ *
+ * 内核不支持IOCB_CMD_POLL、aio-max-nr不足或环的格式不认识时返回0，
+ * 由loop_init继续尝试其他后端。本后端没有backend_fd。
+ */
+int static inline linuxaio_init(struct ev_loop *loop, int flags)
+{
+    /* IOCB_CMD_POLL在4.18加入，4.19之前的实现有缺陷 */
+    if (ev_linux_version() < 0x041300)
+        return 0;
+
+    linuxaio_ringsize = EV_LINUXAIO_DEPTH;
+
+    if (linuxaio_io_setup(loop) < 0)
+        return 0;
+
+    backend_mintime = 1e-6; /* 超时使用纳秒精度的timespec */
+    backend_modify = linuxaio_modify;
+    backend_modify_batch = linuxaio_modify_batch;
+    backend_poll = linuxaio_poll;
+
+    linuxaio_inflight = 0;
+    linuxaio_submits = 0;
+    linuxaio_submitmax = 0;
+    linuxaio_submitcnt = 0;
+    linuxaio_readys = 0;
+    linuxaio_readymax = 0;
+    linuxaio_readycnt = 0;
+
+    return EVBACKEND_LINUXAIO;
+}
+
+/*
+ * 销毁Linux AIO后端资源
+ * @param loop 事件循环实例
+ *
+ * 销毁AIO上下文(同时撤销其中的全部请求)，释放iocb和各个数组，anfds的页随后由循环释放
+ */
+void static inline linuxaio_destroy(struct ev_loop *loop)
+{
+    int page, i;
+
+    evsys_io_destroy(linuxaio_ctx);
+
+    for (page = 0; page < anfds.pagemax; ++page)
+        if (anfds.coldpages[page] != anfd_zero_coldpage)
+            for (i = 0; i < (int)EV_ANFD_PAGESIZE; ++i)
+            {
+                ev_free(anfds.coldpages[page][i].iocb);
+                anfds.coldpages[page][i].iocb = 0;
+            }
+
+    array_free(linuxaio_submit, EMPTY);
+    array_free(linuxaio_ready, EMPTY);
+}
+
+/*
+ * 处理fork后的Linux AIO状态重建
+ * @param loop 事件循环实例
+ *
+ * 子进程没有继承AIO上下文，建立新的上下文后重新注册所有文件描述符。
+ */
+void static inline linuxaio_fork(struct ev_loop *loop)
+{
+    while (linuxaio_io_setup(loop) < 0)
+        ev_syserr("(libev) linuxaio io_setup");
+
+    linuxaio_rearm_all(loop);
+}
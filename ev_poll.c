@@ -97,23 +97,28 @@ poll_poll(struct ev_loop *loop, ev_tstamp timeout) {
             fd_enomem(loop);
         else if (errno != EINTR)
             ev_syserr("(libev) poll");
-    } else
-        for (p = polls; res; ++p) {
-            assert(("libev: poll() returned illegal result, broken BSD kernel?", p < polls + pollcnt));
-
-            if (expect_false(p->revents)) /* this expect is debatable */
-            {
-                --res;
-
-                if (expect_false(p->revents & POLLNVAL))
-                    fd_kill(loop, p->fd);
-                else
-                    fd_event(
-                        loop,
-                        p->fd,
-                        (p->revents & (POLLOUT | POLLERR | POLLHUP) ? EV_WRITE : 0) | (p->revents & (POLLIN | POLLERR | POLLHUP) ? EV_READ : 0));
-            }
+    } else {
+        int i = 0;
+
+        /* 跳过revents为零的pollfd，res个就绪项都处理完后立即停止 */
+        while (res) {
+            i = scan_revents(polls, i, pollcnt);
+            assert(("libev: poll() returned illegal result, broken BSD kernel?", i < pollcnt));
+            if (expect_false(i >= pollcnt))
+                break;
+
+            p = polls + i++;
+            --res;
+
+            if (expect_false(p->revents & POLLNVAL))
+                fd_kill(loop, p->fd);
+            else
+                fd_event(
+                    loop,
+                    p->fd,
+                    (p->revents & (POLLOUT | POLLERR | POLLHUP) ? EV_WRITE : 0) | (p->revents & (POLLIN | POLLERR | POLLHUP) ? EV_READ : 0));
         }
+    }
 }
 
 int static inline
@@ -122,6 +127,8 @@ poll_init(struct ev_loop *loop, int flags) {
     backend_modify = poll_modify;
     backend_poll = poll_poll;
 
+    scan_init();
+
     pollidxs = 0;
     pollidxmax = 0;
     polls = 0;
@@ -0,0 +1,147 @@
+/*
+ * select和poll后端的就绪扫描。
+ *
+ * a) select返回后要在整个位图中找出置位的fd，poll返回后要在整个pollfd数组中找出
+ *    revents非零的项。大量空闲fd时，这个线性扫描仅次于系统调用本身。
+ * b) 向量版本每次检查32字节的块，整块为零时直接跳过，只有非零块才逐字用ctz取出fd。
+ * c) 在x86-64上编译SSE2和AVX2两个版本，第一次初始化后端时按CPU能力选择；
+ *    其他平台或EV_USE_SIMD_SCAN为0时使用标量版本。
+ */
+
+#if EV_USE_POLL
+#include <poll.h>
+#endif
+
+#if EV_USE_SIMD_SCAN
+#include <immintrin.h>
+#endif
+
+/* 扫描块的字节数，也是select扫描返回的偏移量的对齐单位 */
+#define EV_SCAN_BLOCK 32
+
+/* 返回从pos(EV_SCAN_BLOCK的整数倍)开始，第一个a|b不全为零的块的偏移量，没有则返回len */
+static size_t
+scan_bits_scalar(const unsigned char *a, const unsigned char *b, size_t pos, size_t len) {
+    for (; pos < len; pos += EV_SCAN_BLOCK) {
+        size_t end = pos + EV_SCAN_BLOCK < len ? pos + EV_SCAN_BLOCK : len;
+        size_t i;
+
+        for (i = pos; i < end; ++i)
+            if (a[i] | b[i])
+                return pos;
+    }
+
+    return len;
+}
+
+#if EV_USE_POLL
+/* 返回从pos开始第一个revents非零的pollfd的下标，没有则返回cnt */
+static int
+scan_revents_scalar(const struct pollfd *p, int pos, int cnt) {
+    for (; pos < cnt; ++pos)
+        if (p[pos].revents)
+            return pos;
+
+    return cnt;
+}
+#endif
+
+#if EV_USE_SIMD_SCAN
+
+#if EV_USE_POLL
+/* 向量版本按小端、8字节的pollfd布局直接比较revents所在的第3个16位字 */
+static_assert(sizeof(struct pollfd) == 8 && offsetof(struct pollfd, revents) == 6,
+              "libev: unexpected struct pollfd layout for vectorized scan");
+#endif
+
+static size_t
+scan_bits_sse2(const unsigned char *a, const unsigned char *b, size_t pos, size_t len) {
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; pos + EV_SCAN_BLOCK <= len; pos += EV_SCAN_BLOCK) {
+        __m128i lo = _mm_or_si128(_mm_loadu_si128((const __m128i *)(a + pos)),
+                                  _mm_loadu_si128((const __m128i *)(b + pos)));
+        __m128i hi = _mm_or_si128(_mm_loadu_si128((const __m128i *)(a + pos + 16)),
+                                  _mm_loadu_si128((const __m128i *)(b + pos + 16)));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(lo, hi), zero)) != 0xffff)
+            return pos;
+    }
+
+    return scan_bits_scalar(a, b, pos, len);
+}
+
+__attribute__((target("avx2"))) static size_t
+scan_bits_avx2(const unsigned char *a, const unsigned char *b, size_t pos, size_t len) {
+    for (; pos + EV_SCAN_BLOCK <= len; pos += EV_SCAN_BLOCK) {
+        __m256i v = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(a + pos)),
+                                    _mm256_loadu_si256((const __m256i *)(b + pos)));
+
+        if (!_mm256_testz_si256(v, v))
+            return pos;
+    }
+
+    return scan_bits_scalar(a, b, pos, len);
+}
+
+#if EV_USE_POLL
+/* 每个pollfd的revents对应movemask结果中每8位里的最高两位 */
+static int
+scan_revents_sse2(const struct pollfd *p, int pos, int cnt) {
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; pos + 4 <= cnt; pos += 4) {
+        unsigned lo = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(p + pos)), zero));
+        unsigned hi = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(p + pos + 2)), zero));
+        unsigned ready = ~(lo | hi << 16) & 0xc0c0c0c0U;
+
+        if (ready)
+            return pos + ecb_ctz32(ready) / 8;
+    }
+
+    return scan_revents_scalar(p, pos, cnt);
+}
+
+__attribute__((target("avx2"))) static int
+scan_revents_avx2(const struct pollfd *p, int pos, int cnt) {
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (; pos + 4 <= cnt; pos += 4) {
+        unsigned ready = ~(unsigned)_mm256_movemask_epi8(
+                             _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(p + pos)), zero)) &
+                         0xc0c0c0c0U;
+
+        if (ready)
+            return pos + ecb_ctz32(ready) / 8;
+    }
+
+    return scan_revents_scalar(p, pos, cnt);
+}
+#endif
+
+#endif
+
+/* 进程内共享，与have_monotonic一样重复初始化是无害的 */
+static size_t (*scan_bits)(const unsigned char *a, const unsigned char *b, size_t pos, size_t len) = scan_bits_scalar;
+#if EV_USE_POLL
+static int (*scan_revents)(const struct pollfd *p, int pos, int cnt) = scan_revents_scalar;
+#endif
+
+static void
+scan_init(void) {
+#if EV_USE_SIMD_SCAN
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2")) {
+        scan_bits = scan_bits_avx2;
+#if EV_USE_POLL
+        scan_revents = scan_revents_avx2;
+#endif
+    } else {
+        scan_bits = scan_bits_sse2;
+#if EV_USE_POLL
+        scan_revents = scan_revents_sse2;
+#endif
+    }
+#endif
+}
@@ -76,7 +76,7 @@ select_modify(struct ev_loop *loop, int fd, int oev, int nev) {
 #if EV_SELECT_USE_FD_SET
 
 #if EV_SELECT_IS_WINSOCKET
-        SOCKET handle = anfds[fd].handle;
+        SOCKET handle = anfds.cold(fd).handle;
 #else
         int handle = fd;
 #endif
@@ -218,7 +218,7 @@ select_poll(struct ev_loop *loop, ev_tstamp timeout) {
             if (anfds[fd].events) {
                 int events = 0;
 #if EV_SELECT_IS_WINSOCKET
-                SOCKET handle = anfds[fd].handle;
+                SOCKET handle = anfds.cold(fd).handle;
 #else
                 int handle = fd;
 #endif
@@ -240,25 +240,37 @@ select_poll(struct ev_loop *loop, ev_tstamp timeout) {
 #else
 
     {
-        int word, bit;
-        for (word = vec_max; word--;) {
-            fd_mask word_r = ((fd_mask *)vec_ro)[word];
-            fd_mask word_w = ((fd_mask *)vec_wo)[word];
+        const unsigned char *ro = (const unsigned char *)vec_ro;
+        const unsigned char *wo = (const unsigned char *)vec_wo;
+        size_t len = (size_t)vec_max * NFDBYTES;
+        size_t pos = 0;
+        int word;
+
 #ifdef _WIN32
-            word_w |= ((fd_mask *)vec_eo)[word];
+        for (word = 0; word < vec_max; ++word)
+            ((fd_mask *)vec_wo)[word] |= ((fd_mask *)vec_eo)[word];
 #endif
 
-            if (word_r || word_w)
-                for (bit = NFDBITS; bit--;) {
-                    fd_mask mask = 1UL << bit;
-                    int events = 0;
+        /* 整块为零的部分直接跳过，非零块中逐字用ctz取出置位的fd */
+        while ((pos = scan_bits(ro, wo, pos, len)) < len) {
+            size_t end = pos + EV_SCAN_BLOCK < len ? pos + EV_SCAN_BLOCK : len;
+
+            for (word = pos / NFDBYTES; word < (int)(end / NFDBYTES); ++word) {
+                unsigned long word_r = (unsigned long)((fd_mask *)vec_ro)[word];
+                unsigned long word_w = (unsigned long)((fd_mask *)vec_wo)[word];
+                unsigned long bits = word_r | word_w;
 
-                    events |= word_r & mask ? EV_READ : 0;
-                    events |= word_w & mask ? EV_WRITE : 0;
+                while (bits) {
+                    int bit = ecb_ctz64(bits);
+                    unsigned long mask = 1UL << bit;
 
-                    if (expect_true(events))
-                        fd_event(loop, word * NFDBITS + bit, events);
+                    bits &= bits - 1;
+                    fd_event(loop, word * NFDBITS + bit,
+                             (word_r & mask ? EV_READ : 0) | (word_w & mask ? EV_WRITE : 0));
                 }
+            }
+
+            pos = end;
         }
     }
 
@@ -271,6 +283,8 @@ select_init(struct ev_loop *loop, int flags) {
     backend_modify = select_modify;
     backend_poll = select_poll;
 
+    scan_init();
+
 #if EV_SELECT_USE_FD_SET
     vec_ri = ev_malloc(sizeof(fd_set));
     FD_ZERO((fd_set *)vec_ri);
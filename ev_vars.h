@@ -7,8 +7,8 @@ struct ev_loop
     using ev_tstamp = double;
     ev_tstamp ev_rt_now;
 
-    ev_tstamp now_floor;        /* 上次刷新实时时间的时间点 */
-    ev_tstamp mn_now;           /* 单调时钟当前时间 */
+    ev_timekey now_floor;       /* 上次刷新实时时间的时间点 */
+    ev_timekey mn_now;          /* 单调时钟当前时间 */
     VARx(ev_tstamp, rtmn_diff); /* 实时时间与单调时间的差值 */
 
     /* 用于事件的反向馈送 */
@@ -24,6 +24,8 @@ struct ev_loop
 
     VARx(ev_tstamp, io_blocktime);      /* I/O操作最大阻塞时间 */
     VARx(ev_tstamp, timeout_blocktime); /* 超时事件最大阻塞时间 */
+    VARx(ev_tstamp, busy_poll);         /* 阻塞等待前忙轮询的时间预算，0表示不忙轮询 */
+    VARx(ev_tstamp, timer_slack);       /* 超时唤醒允许推迟的时间，窗口重叠的定时器合并到一次唤醒 */
 
     VARx(int, backend);   /* 当前使用的后端I/O多路复用机制 */
     VARx(int, activecnt); /* 活跃事件总数("refcount") */
@@ -35,8 +37,9 @@ struct ev_loop
 
     VAR(backend_modify, void (*backend_modify)(struct ev_loop *loop, int fd, int oev, int nev)); /* 修改后端文件描述符状态的函数指针 */
     VAR(backend_poll, void (*backend_poll)(struct ev_loop *loop, ev_tstamp timeout));            /* 轮询后端事件的函数指针 */
-    VARx(ANFD *, anfds);
-    VARx(int, anfdmax);                    /* 活动文件描述符数组的最大容量 */
+    VAR(backend_modify_batch, void (*backend_modify_batch)(struct ev_loop *loop, const ANFDMOD *mods, int cnt)); /* 可选，一次接收fd_reify的全部变更 */
+    VARx(ANFDS, anfds);                    /* 以fd为下标的分页表 */
+    VARx(int, anfdmax);                    /* anfds可访问的fd上限(页目录容量乘以每页项数) */
     VAR(evpipe, int evpipe[2]);            /* 用于线程间通信的管道 */
     VARx(ev_io, pipe_w);                   /* 管道读端的I/O观察者 */
     VARx(EV_ATOMIC_T, pipe_write_wanted);  /* 需要写入管道的标志(原子操作) */
@@ -74,6 +77,43 @@ struct ev_loop
     VARx(int *, epoll_eperms);                /* epoll权限错误文件描述符数组 */
     VARx(int, epoll_epermcnt);                /* epoll权限错误计数 */
     VARx(int, epoll_epermmax);                /* epoll权限错误数组最大容量 */
+    VARx(char, epoll_have_pwait2);            /* 内核是否支持纳秒精度的epoll_pwait2 */
+    VARx(int, epoll_timerfd);                 /* 没有epoll_pwait2时用于亚毫秒唤醒的timerfd，-1表示不可用 */
+#endif
+
+#if EV_USE_IOURING || EV_GENWRAP
+    VARx(char *, iouring_sq_ring);             /* io_uring提交队列环(与内核共享的内存) */
+    VARx(char *, iouring_cq_ring);             /* io_uring完成队列环(与内核共享的内存) */
+    VARx(struct io_uring_sqe *, iouring_sqes); /* io_uring提交队列条目数组 */
+    VARx(uint32_t, iouring_sq_ring_size);      /* 提交队列环的映射大小 */
+    VARx(uint32_t, iouring_cq_ring_size);      /* 完成队列环的映射大小 */
+    VARx(uint32_t, iouring_sqes_size);         /* 提交队列条目数组的映射大小 */
+    VARx(uint32_t, iouring_sq_head);           /* 提交队列头在环中的偏移 */
+    VARx(uint32_t, iouring_sq_tail);           /* 提交队列尾在环中的偏移 */
+    VARx(uint32_t, iouring_sq_ring_mask);      /* 提交队列掩码在环中的偏移 */
+    VARx(uint32_t, iouring_sq_ring_entries);   /* 提交队列长度在环中的偏移 */
+    VARx(uint32_t, iouring_sq_flags);          /* 提交队列标志在环中的偏移 */
+    VARx(uint32_t, iouring_sq_array);          /* 提交队列索引数组在环中的偏移 */
+    VARx(uint32_t, iouring_cq_head);           /* 完成队列头在环中的偏移 */
+    VARx(uint32_t, iouring_cq_tail);           /* 完成队列尾在环中的偏移 */
+    VARx(uint32_t, iouring_cq_ring_mask);      /* 完成队列掩码在环中的偏移 */
+    VARx(uint32_t, iouring_cq_cqes);           /* 完成队列条目数组在环中的偏移 */
+    VARx(int, iouring_to_submit);              /* 已写入但尚未发布给内核的sqe数量 */
+    VARx(int, iouring_timeouts);               /* 内核中尚未完成的超时请求数量 */
+    VARx(char, iouring_ext_arg);               /* 内核是否支持IORING_ENTER_EXT_ARG */
+    VARx(char, iouring_multishot);             /* 内核是否支持IORING_POLL_ADD_MULTI */
+#endif
+
+#if EV_USE_LINUXAIO || EV_GENWRAP
+    VARx(unsigned long, linuxaio_ctx);      /* AIO上下文(aio_context_t)，也是用户空间中环的地址 */
+    VARx(int, linuxaio_ringsize);           /* 建立上下文时请求的环大小 */
+    VARx(int, linuxaio_inflight);           /* 已提交或等待提交的请求数，决定环的大小 */
+    VARx(struct iocb **, linuxaio_submits); /* 等待提交的请求 */
+    VARx(int, linuxaio_submitmax);          /* 提交数组最大容量 */
+    VARx(int, linuxaio_submitcnt);          /* 当前等待提交的请求数 */
+    VARx(int *, linuxaio_readys);           /* 内核拒绝poll、视为总是就绪的fd */
+    VARx(int, linuxaio_readymax);           /* 总是就绪数组最大容量 */
+    VARx(int, linuxaio_readycnt);           /* 总是就绪的fd数量 */
 #endif
 
 #if EV_USE_KQUEUE || EV_GENWRAP
@@ -97,15 +137,42 @@ struct ev_loop
     VARx(int *, fdchanges);
     VARx(int, fdchangemax); /* 文件描述符变更数组最大容量 */
     VARx(int, fdchangecnt); /* 当前文件描述符变更计数 */
+    VARx(ANFDMOD *, fdmods); /* 交给backend_modify_batch的变更数组 */
+    VARx(int, fdmodmax);     /* 变更数组最大容量 */
+    VARx(int, fdmodcnt);     /* 当前批量变更计数 */
 
     VARx(ANHE *, timers); /* 定时器堆数组 */
     VARx(int, timermax);  /* 定时器堆最大容量 */
     VARx(int, timercnt);  /* 当前定时器计数 */
 
+#if EV_USE_LAZYTIMERS || EV_GENWRAP
+    VARx(ev_watcher_time, timertomb); /* 墓碑占位符，已停止但仍留在堆中的槽位指向它 */
+    VARx(int, timerdead);             /* 堆中墓碑的数量，包含在timercnt中 */
+#endif
+
+#if EV_USE_TIMERWHEEL || EV_GENWRAP
+    VARx(ANTW *, timerlinks);        /* 与timers同下标的时间轮链接 */
+    VARx(int, timerlinkmax);         /* timerlinks的容量 */
+    VARx(int64_t, timerwheel_tick);  /* 下一个要处理的第0层格 */
+    VARx(WT *, timerwheel_work);     /* timers_reify中一个槽的临时数组 */
+    VARx(int, timerwheel_workmax);   /* timerwheel_work的容量 */
+    VAR(timerwheel, int timerwheel[EV_TIMERWHEEL_LEVELS * EV_TIMERWHEEL_SLOTS]);                        /* 各层各槽链表头在timers中的下标 */
+    VAR(timerwheel_bits, uint64_t timerwheel_bits[EV_TIMERWHEEL_LEVELS * EV_TIMERWHEEL_SLOTS / 64]); /* 非空槽的位图 */
+#endif
+
+#if EV_HRTIMER_ENABLE || EV_GENWRAP
+    VARx(ANHE *, hrtimers);       /* 高精度定时器堆数组 */
+    VARx(int, hrtimermax);        /* 高精度定时器堆最大容量 */
+    VARx(int, hrtimercnt);        /* 当前高精度定时器计数 */
+    VARx(ev_tstamp, hires_margin); /* 阻塞到最早的高精度定时器到期前的这段时间，余下的自旋等待 */
+#endif
+
 #if EV_PERIODIC_ENABLE || EV_GENWRAP
-    VARx(ANHE *, periodics); /* 周期性定时器堆数组 */
-    VARx(int, periodicmax);  /* 周期性定时器堆最大容量 */
-    VARx(int, periodiccnt);  /* 当前周期性定时器计数 */
+    VARx(ANHE *, periodics);       /* 周期性定时器堆数组 */
+    VARx(int, periodicmax);        /* 周期性定时器堆最大容量 */
+    VARx(int, periodiccnt);        /* 当前周期性定时器计数 */
+    VARx(int, periodicstale);      /* 堆之后尚未按时间跳变重新计算的周期定时器数量 */
+    VARx(ev_tstamp, periodicjump); /* 时间跳变后重新计算所依据的实时时间 */
 #endif
 
 #if EV_IDLE_ENABLE || EV_GENWRAP
@@ -137,11 +204,22 @@ struct ev_loop
     VARx(int, cleanupcnt);                /* 当前清理观察者计数 */
 #endif
 
+#if EV_DEADLINE_ENABLE || EV_GENWRAP
+    VARx(ANDL **, deadlinegroups); /* 各timeout的空闲超时组 */
+    VARx(int, deadlinegroupmax);   /* 空闲超时组数组最大容量 */
+    VARx(int, deadlinegroupcnt);   /* 当前空闲超时组计数 */
+#endif
+
 #if EV_ASYNC_ENABLE || EV_GENWRAP
     VARx(EV_ATOMIC_T, async_pending); /* 待处理异步事件标志(原子操作) */
     VARx(struct ev_async **, asyncs); /* 异步观察者数组 */
     VARx(int, asyncmax);              /* 异步观察者最大数量 */
     VARx(int, asynccnt);              /* 当前异步观察者计数 */
+    VARx(ANFEED *, feedmt);           /* ev_feed_event_mt的投递队列 */
+    VARx(unsigned int, feedmtmask);   /* 投递队列容量-1 */
+    VARx(unsigned int, feedmthead);   /* 下一个写入序号(投递线程原子递增) */
+    VARx(unsigned int, feedmttail);   /* 下一个取出序号(只由循环线程访问) */
+    VARx(EV_ATOMIC_T, feedmt_pending); /* 投递队列中有事件待取出 */
 #endif
 
 #if EV_USE_INOTIFY || EV_GENWRAP
@@ -158,6 +236,23 @@ struct ev_loop
     VARx(sigset_t, sigfd_set); /* signalfd信号集 */
 #endif
 
+#if EV_USE_TIMERFD || EV_GENWRAP
+    VARx(int, timerfd);          /* EVFLAG_TIMERFD的timerfd，-1表示未使用 */
+    VARx(ev_io, timerfd_w);      /* timerfd I/O观察者 */
+    VARx(ev_timekey, timerfd_at); /* timerfd当前设置的绝对到期时刻，0表示未设置 */
+#endif
+
+#if EV_USE_COARSE_CLOCK || EV_GENWRAP
+    VARx(char, clock_coarse); /* 是否按EVFLAG_COARSE_CLOCK读取*_COARSE时钟 */
+#endif
+
+#if EV_USE_TSC || EV_GENWRAP
+    VARx(uint64_t, tsc_base);       /* 上次校准时的TSC读数，0表示不使用TSC */
+    VARx(ev_timekey, tsc_mn_base);  /* 上次校准时的单调时钟 */
+    VARx(double, tsc_scale);        /* 每个TSC周期对应的单调时钟增量，0表示首次校准尚未完成 */
+    VARx(ev_timekey, tsc_recal_at); /* 单调时钟到达此时刻时重新校准 */
+#endif
+
     VARx(unsigned int, origflags); /* 事件循环的原始标志位 */
 
 #if EV_FEATURE_API || EV_GENWRAP
@@ -25,8 +25,12 @@
 #define backend_mintime ((loop)->backend_mintime)
 /* 修改后端文件描述符状态的函数指针 */
 #define backend_modify ((loop)->backend_modify)
+/* 批量修改后端文件描述符状态的函数指针 */
+#define backend_modify_batch ((loop)->backend_modify_batch)
 /* 轮询后端事件的函数指针 */
 #define backend_poll ((loop)->backend_poll)
+/* 阻塞等待前忙轮询的时间预算 */
+#define busy_poll ((loop)->busy_poll)
 /* 当前检查观察者计数 */
 #define checkcnt ((loop)->checkcnt)
 /* 检查观察者最大数量 */
@@ -39,8 +43,16 @@
 #define cleanupmax ((loop)->cleanupmax)
 /* 清理观察者数组 */
 #define cleanups ((loop)->cleanups)
+/* 是否读取*_COARSE时钟 */
+#define clock_coarse ((loop)->clock_coarse)
 /* 当前进程ID */
 #define curpid ((loop)->curpid)
+/* 当前空闲超时组计数 */
+#define deadlinegroupcnt ((loop)->deadlinegroupcnt)
+/* 空闲超时组数组最大容量 */
+#define deadlinegroupmax ((loop)->deadlinegroupmax)
+/* 各timeout的空闲超时组 */
+#define deadlinegroups ((loop)->deadlinegroups)
 /* epoll权限错误计数 */
 #define epoll_epermcnt ((loop)->epoll_epermcnt)
 /* epoll权限错误数组最大容量 */
@@ -51,6 +63,10 @@
 #define epoll_eventmax ((loop)->epoll_eventmax)
 /* epoll后端的事件数组 */
 #define epoll_events ((loop)->epoll_events)
+/* 内核是否支持epoll_pwait2 */
+#define epoll_have_pwait2 ((loop)->epoll_have_pwait2)
+/* epoll后端用于亚毫秒唤醒的timerfd */
+#define epoll_timerfd ((loop)->epoll_timerfd)
 /* 用于线程间通信的管道 */
 #define evpipe ((loop)->evpipe)
 /* 当前文件描述符变更计数 */
@@ -59,6 +75,22 @@
 #define fdchangemax ((loop)->fdchangemax)
 /* 文件描述符变更数组 */
 #define fdchanges ((loop)->fdchanges)
+/* 当前批量变更计数 */
+#define fdmodcnt ((loop)->fdmodcnt)
+/* 批量变更数组最大容量 */
+#define fdmodmax ((loop)->fdmodmax)
+/* 批量变更数组 */
+#define fdmods ((loop)->fdmods)
+/* ev_feed_event_mt的投递队列 */
+#define feedmt ((loop)->feedmt)
+/* 投递队列中有事件待取出 */
+#define feedmt_pending ((loop)->feedmt_pending)
+/* 下一个写入序号 */
+#define feedmthead ((loop)->feedmthead)
+/* 投递队列容量-1 */
+#define feedmtmask ((loop)->feedmtmask)
+/* 下一个取出序号 */
+#define feedmttail ((loop)->feedmttail)
 /* 当前fork观察者计数 */
 #define forkcnt ((loop)->forkcnt)
 /* fork观察者最大数量 */
@@ -74,6 +106,14 @@
 // #define ev_rt_now ((loop)->ev_rt_now)
 /* inotify I/O观察者 */
 #define fs_w ((loop)->fs_w)
+/* 高精度定时器的自旋余量 */
+#define hires_margin ((loop)->hires_margin)
+/* 当前高精度定时器计数 */
+#define hrtimercnt ((loop)->hrtimercnt)
+/* 高精度定时器堆最大容量 */
+#define hrtimermax ((loop)->hrtimermax)
+/* 高精度定时器堆数组 */
+#define hrtimers ((loop)->hrtimers)
 /* 空闲观察者总数 */
 #define idleall ((loop)->idleall)
 /* 每个优先级的当前空闲观察者计数 */
@@ -88,6 +128,46 @@
 #define io_blocktime ((loop)->io_blocktime)
 /* Windows IOCP后端的完成端口句柄 */
 #define iocp ((loop)->iocp)
+/* 完成队列条目数组在环中的偏移 */
+#define iouring_cq_cqes ((loop)->iouring_cq_cqes)
+/* 完成队列头在环中的偏移 */
+#define iouring_cq_head ((loop)->iouring_cq_head)
+/* io_uring完成队列环(与内核共享的内存) */
+#define iouring_cq_ring ((loop)->iouring_cq_ring)
+/* 完成队列掩码在环中的偏移 */
+#define iouring_cq_ring_mask ((loop)->iouring_cq_ring_mask)
+/* 完成队列环的映射大小 */
+#define iouring_cq_ring_size ((loop)->iouring_cq_ring_size)
+/* 完成队列尾在环中的偏移 */
+#define iouring_cq_tail ((loop)->iouring_cq_tail)
+/* 内核是否支持IORING_ENTER_EXT_ARG */
+#define iouring_ext_arg ((loop)->iouring_ext_arg)
+/* 内核是否支持多次触发的poll请求 */
+#define iouring_multishot ((loop)->iouring_multishot)
+/* 提交队列索引数组在环中的偏移 */
+#define iouring_sq_array ((loop)->iouring_sq_array)
+/* 提交队列标志在环中的偏移 */
+#define iouring_sq_flags ((loop)->iouring_sq_flags)
+/* 提交队列头在环中的偏移 */
+#define iouring_sq_head ((loop)->iouring_sq_head)
+/* io_uring提交队列环(与内核共享的内存) */
+#define iouring_sq_ring ((loop)->iouring_sq_ring)
+/* 提交队列长度在环中的偏移 */
+#define iouring_sq_ring_entries ((loop)->iouring_sq_ring_entries)
+/* 提交队列掩码在环中的偏移 */
+#define iouring_sq_ring_mask ((loop)->iouring_sq_ring_mask)
+/* 提交队列环的映射大小 */
+#define iouring_sq_ring_size ((loop)->iouring_sq_ring_size)
+/* 提交队列尾在环中的偏移 */
+#define iouring_sq_tail ((loop)->iouring_sq_tail)
+/* io_uring提交队列条目数组 */
+#define iouring_sqes ((loop)->iouring_sqes)
+/* 提交队列条目数组的映射大小 */
+#define iouring_sqes_size ((loop)->iouring_sqes_size)
+/* 内核中尚未完成的超时请求数量 */
+#define iouring_timeouts ((loop)->iouring_timeouts)
+/* 已写入但尚未发布给内核的sqe数量 */
+#define iouring_to_submit ((loop)->iouring_to_submit)
 /* kqueue当前变更计数 */
 #define kqueue_changecnt ((loop)->kqueue_changecnt)
 /* kqueue变更数组最大容量 */
@@ -100,6 +180,24 @@
 #define kqueue_events ((loop)->kqueue_events)
 /* kqueue文件描述符所属进程ID */
 #define kqueue_fd_pid ((loop)->kqueue_fd_pid)
+/* AIO上下文 */
+#define linuxaio_ctx ((loop)->linuxaio_ctx)
+/* 已提交或等待提交的linuxaio请求数 */
+#define linuxaio_inflight ((loop)->linuxaio_inflight)
+/* 总是就绪的fd数量 */
+#define linuxaio_readycnt ((loop)->linuxaio_readycnt)
+/* 总是就绪数组最大容量 */
+#define linuxaio_readymax ((loop)->linuxaio_readymax)
+/* 总是就绪的fd */
+#define linuxaio_readys ((loop)->linuxaio_readys)
+/* AIO环大小 */
+#define linuxaio_ringsize ((loop)->linuxaio_ringsize)
+/* 等待提交的AIO请求数 */
+#define linuxaio_submitcnt ((loop)->linuxaio_submitcnt)
+/* AIO提交数组最大容量 */
+#define linuxaio_submitmax ((loop)->linuxaio_submitmax)
+/* 等待提交的AIO请求 */
+#define linuxaio_submits ((loop)->linuxaio_submits)
 /* 事件循环迭代/阻塞总次数 */
 #define loop_count ((loop)->loop_count)
 /* ev_run进入次数 - ev_run离开次数 */
@@ -124,10 +222,14 @@
 #define pendings ((loop)->pendings)
 /* 当前周期性定时器计数 */
 #define periodiccnt ((loop)->periodiccnt)
+/* 时间跳变后重新计算所依据的实时时间 */
+#define periodicjump ((loop)->periodicjump)
 /* 周期性定时器堆最大容量 */
 #define periodicmax ((loop)->periodicmax)
 /* 周期性定时器堆数组 */
 #define periodics ((loop)->periodics)
+/* 堆之后尚未重新计算的周期定时器数量 */
+#define periodicstale ((loop)->periodicstale)
 /* 管道读端的I/O观察者 */
 #define pipe_w ((loop)->pipe_w)
 /* 跳过管道写入的次数(原子操作) */
@@ -176,12 +278,46 @@
 #define sigfd_w ((loop)->sigfd_w)
 /* 超时事件最大阻塞时间 */
 #define timeout_blocktime ((loop)->timeout_blocktime)
+/* 超时唤醒允许推迟的时间 */
+#define timer_slack ((loop)->timer_slack)
 /* 当前定时器计数 */
 #define timercnt ((loop)->timercnt)
+/* 堆中墓碑的数量 */
+#define timerdead ((loop)->timerdead)
+/* timerfd文件描述符 */
+#define timerfd ((loop)->timerfd)
+/* timerfd设置的绝对到期时刻 */
+#define timerfd_at ((loop)->timerfd_at)
+/* timerfd I/O观察者 */
+#define timerfd_w ((loop)->timerfd_w)
+/* timerlinks的容量 */
+#define timerlinkmax ((loop)->timerlinkmax)
+/* 与timers同下标的时间轮链接 */
+#define timerlinks ((loop)->timerlinks)
 /* 定时器堆最大容量 */
 #define timermax ((loop)->timermax)
 /* 定时器堆数组 */
 #define timers ((loop)->timers)
+/* 墓碑占位符 */
+#define timertomb ((loop)->timertomb)
+/* 时间轮各槽链表头 */
+#define timerwheel ((loop)->timerwheel)
+/* 时间轮非空槽的位图 */
+#define timerwheel_bits ((loop)->timerwheel_bits)
+/* 下一个要处理的第0层格 */
+#define timerwheel_tick ((loop)->timerwheel_tick)
+/* timers_reify中一个槽的临时数组 */
+#define timerwheel_work ((loop)->timerwheel_work)
+/* timerwheel_work的容量 */
+#define timerwheel_workmax ((loop)->timerwheel_workmax)
+/* 上次校准时的TSC读数 */
+#define tsc_base ((loop)->tsc_base)
+/* 上次校准时的单调时钟 */
+#define tsc_mn_base ((loop)->tsc_mn_base)
+/* 下次重新校准的单调时钟时刻 */
+#define tsc_recal_at ((loop)->tsc_recal_at)
+/* 每个TSC周期对应的单调时钟增量 */
+#define tsc_scale ((loop)->tsc_scale)
 /* 用户自定义数据指针 */
 #define userdata ((loop)->userdata)
 /* select后端的异常文件描述符集(Windows特有) */
@@ -210,23 +346,39 @@
 #undef backend_fd
 #undef backend_mintime
 #undef backend_modify
+#undef backend_modify_batch
 #undef backend_poll
+#undef busy_poll
 #undef checkcnt
 #undef checkmax
 #undef checks
 #undef cleanupcnt
 #undef cleanupmax
 #undef cleanups
+#undef clock_coarse
 #undef curpid
+#undef deadlinegroupcnt
+#undef deadlinegroupmax
+#undef deadlinegroups
 #undef epoll_epermcnt
 #undef epoll_epermmax
 #undef epoll_eperms
 #undef epoll_eventmax
 #undef epoll_events
+#undef epoll_have_pwait2
+#undef epoll_timerfd
 #undef evpipe
 #undef fdchangecnt
 #undef fdchangemax
 #undef fdchanges
+#undef fdmodcnt
+#undef fdmodmax
+#undef fdmods
+#undef feedmt
+#undef feedmt_pending
+#undef feedmthead
+#undef feedmtmask
+#undef feedmttail
 #undef forkcnt
 #undef forkmax
 #undef forks
@@ -234,6 +386,10 @@
 #undef fs_fd
 #undef fs_hash
 #undef fs_w
+#undef hires_margin
+#undef hrtimercnt
+#undef hrtimermax
+#undef hrtimers
 #undef idleall
 #undef idlecnt
 #undef idlemax
@@ -241,12 +397,41 @@
 #undef invoke_cb
 #undef io_blocktime
 #undef iocp
+#undef iouring_cq_cqes
+#undef iouring_cq_head
+#undef iouring_cq_ring
+#undef iouring_cq_ring_mask
+#undef iouring_cq_ring_size
+#undef iouring_cq_tail
+#undef iouring_ext_arg
+#undef iouring_multishot
+#undef iouring_sq_array
+#undef iouring_sq_flags
+#undef iouring_sq_head
+#undef iouring_sq_ring
+#undef iouring_sq_ring_entries
+#undef iouring_sq_ring_mask
+#undef iouring_sq_ring_size
+#undef iouring_sq_tail
+#undef iouring_sqes
+#undef iouring_sqes_size
+#undef iouring_timeouts
+#undef iouring_to_submit
 #undef kqueue_changecnt
 #undef kqueue_changemax
 #undef kqueue_changes
 #undef kqueue_eventmax
 #undef kqueue_events
 #undef kqueue_fd_pid
+#undef linuxaio_ctx
+#undef linuxaio_inflight
+#undef linuxaio_readycnt
+#undef linuxaio_readymax
+#undef linuxaio_readys
+#undef linuxaio_ringsize
+#undef linuxaio_submitcnt
+#undef linuxaio_submitmax
+#undef linuxaio_submits
 #undef loop_count
 #undef loop_depth
 #undef loop_done
@@ -259,8 +444,10 @@
 #undef pendingpri
 #undef pendings
 #undef periodiccnt
+#undef periodicjump
 #undef periodicmax
 #undef periodics
+#undef periodicstale
 #undef pipe_w
 #undef pipe_write_skipped
 #undef pipe_write_wanted
@@ -285,9 +472,26 @@
 #undef sigfd_set
 #undef sigfd_w
 #undef timeout_blocktime
+#undef timer_slack
 #undef timercnt
+#undef timerdead
+#undef timerfd
+#undef timerfd_at
+#undef timerfd_w
+#undef timerlinkmax
+#undef timerlinks
 #undef timermax
 #undef timers
+#undef timertomb
+#undef timerwheel
+#undef timerwheel_bits
+#undef timerwheel_tick
+#undef timerwheel_work
+#undef timerwheel_workmax
+#undef tsc_base
+#undef tsc_mn_base
+#undef tsc_recal_at
+#undef tsc_scale
 #undef userdata
 #undef vec_eo
 #undef vec_max
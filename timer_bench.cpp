@@ -0,0 +1,107 @@
+/**
+ * 定时器堆性能测试程序
+ *
+ * 本程序在一个事件循环上放入大量超时时间随机的定时器，分别测量：
+ * 1. 启动：ev_timer_start，每次一次upheap
+ * 2. 重置：ev_timer_again，模拟每收到一个包就刷新空闲超时，主要是downheap
+ * 3. 到期：短周期的重复定时器不断到期，timers_reify每次都从堆顶downheap
+ * 4. 停止：ev_timer_stop
+ *
+ * 超时时间是随机的，downheap中选最小子节点的比较结果也是随机的，
+ * 适合对比EV_USE_SIMD_HEAP打开和关闭时分支预测失败的开销。
+ *
+ * 编译命令: g++ -std=c++20 -O2 -o timer_bench timer_bench.cpp ev.cpp
+ *           (加上-DEV_USE_SIMD_HEAP=0得到标量版本)
+ * 运行方式: ./timer_bench [定时器数量] [重置次数倍数]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#include "ev.h"
+
+/* 当前单调时间(秒)，只用于统计耗时 */
+static double bench_now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long fired; /* 到期阶段回调次数 */
+
+static void timer_cb(struct ev_loop *loop, ev_timer *w, int revents)
+{
+    ++fired;
+}
+
+static void stop_cb(struct ev_loop *loop, ev_timer *w, int revents)
+{
+    ev_break(loop, EVBREAK_ALL);
+}
+
+int main(int argc, char **argv)
+{
+    int n = argc > 1 ? atoi(argv[1]) : 1000000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    struct ev_loop *loop = ev_loop_new(EVFLAG_AUTO);
+    std::vector<ev_timer> timers(n);
+    ev_timer stop;
+    double t0, t1, t2, t3, t4;
+
+    srand(1);
+
+    /* 超时在30~60秒之间，测试期间都不会到期 */
+    t0 = bench_now();
+    for (int i = 0; i < n; ++i)
+    {
+        ev_timer_init(&timers[i], timer_cb, 0., 30. + 30. * rand() / RAND_MAX);
+        ev_timer_again(loop, &timers[i]);
+    }
+
+    t1 = bench_now();
+    for (long k = 0; k < (long)rounds * n; ++k)
+    {
+        ev_timer_again(loop, &timers[rand() % n]);
+
+        /* 时间要向前走，否则重置后的at不变，堆几乎不用调整 */
+        if (!(k % 1000))
+            ev_now_update(loop);
+    }
+
+    t2 = bench_now();
+    for (int i = 0; i < n; ++i)
+        ev_timer_stop(loop, &timers[i]);
+
+    /* 1~10毫秒的重复定时器，运行半秒，几乎每次循环都有大量定时器到期 */
+    for (int i = 0; i < n; ++i)
+    {
+        ev_timer_set(&timers[i], 0., 0.001 + 0.009 * rand() / RAND_MAX);
+        ev_timer_again(loop, &timers[i]);
+    }
+
+    ev_timer_init(&stop, stop_cb, 0.5, 0.);
+    ev_timer_start(loop, &stop);
+
+    t3 = bench_now();
+    ev_run(loop, 0);
+    t4 = bench_now();
+
+    printf("timers %d\n", n);
+    printf("start  %6.1f ns/op\n", (t1 - t0) / n * 1e9);
+    printf("again  %6.1f ns/op\n", (t2 - t1) / ((double)rounds * n) * 1e9);
+    printf("expire %6.1f ns/op (%ld callbacks)\n", (t4 - t3) / (fired ? fired : 1) * 1e9, fired);
+
+    t0 = bench_now();
+    for (int i = 0; i < n; ++i)
+        ev_timer_stop(loop, &timers[i]);
+    t1 = bench_now();
+
+    printf("stop   %6.1f ns/op\n", (t1 - t0) / n * 1e9);
+
+    ev_loop_destroy(loop);
+
+    return 0;
+}